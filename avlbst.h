@@ -14,13 +14,17 @@ struct KeyError { };
 * A special kind of node for an AVL tree, which adds the balance as a data member, plus
 * other additional helper functions. You do NOT need to implement any functionality or
 * add additional data members or helper functions.
+*
+* With AVL_TAGGED_BALANCE the balance lives in the three tag bits of the parent
+* pointer instead, as a two's complement value in -4..3 (rebalancing briefly
+* stores +-2), and the node is the size of a plain Node.
 */
 template <typename Key, typename Value>
 class AVLNode : public Node<Key, Value>
 {
 public:
     // Constructor/destructor.
-    AVLNode(const Key& key, const Value& value, AVLNode<Key, Value>* parent);
+    AVLNode(const Key& key, const Value& value, AVLNode<Key, Value>* parent, typename Node<Key, Value>::ItemStore* store = nullptr);
     virtual ~AVLNode();
 
     // Getter/setter for the node's height.
@@ -36,7 +40,11 @@ public:
     virtual AVLNode<Key, Value>* getRight() const override;
 
 protected:
+#ifdef AVL_TAGGED_BALANCE
+    static_assert(alignof(Node<Key, Value>) >= 8, "AVL_TAGGED_BALANCE needs 8-byte aligned nodes");
+#else
     int8_t balance_;    // effectively a signed char
+#endif
 };
 
 /*
@@ -49,8 +57,12 @@ protected:
 * An explicit constructor to initialize the elements by calling the base class constructor
 */
 template<class Key, class Value>
-AVLNode<Key, Value>::AVLNode(const Key& key, const Value& value, AVLNode<Key, Value> *parent) :
-    Node<Key, Value>(key, value, parent), balance_(0)
+AVLNode<Key, Value>::AVLNode(const Key& key, const Value& value, AVLNode<Key, Value> *parent, typename Node<Key, Value>::ItemStore* store) :
+#ifdef AVL_TAGGED_BALANCE
+    Node<Key, Value>(key, value, parent, store)
+#else
+    Node<Key, Value>(key, value, parent, store), balance_(0)
+#endif
 {
 
 }
@@ -70,7 +82,11 @@ AVLNode<Key, Value>::~AVLNode()
 template<class Key, class Value>
 int8_t AVLNode<Key, Value>::getBalance() const
 {
+#ifdef AVL_TAGGED_BALANCE
+    return (int8_t)((int)(this->getParentTag() ^ 4) - 4);
+#else
     return balance_;
+#endif
 }
 
 /**
@@ -79,7 +95,11 @@ int8_t AVLNode<Key, Value>::getBalance() const
 template<class Key, class Value>
 void AVLNode<Key, Value>::setBalance(int8_t balance)
 {
+#ifdef AVL_TAGGED_BALANCE
+    this->setParentTag((unsigned)balance & 7);
+#else
     balance_ = balance;
+#endif
 }
 
 /**
@@ -88,7 +108,7 @@ void AVLNode<Key, Value>::setBalance(int8_t balance)
 template<class Key, class Value>
 void AVLNode<Key, Value>::updateBalance(int8_t diff)
 {
-    balance_ += diff;
+    setBalance(getBalance() + diff);
 }
 
 /**
@@ -98,7 +118,7 @@ void AVLNode<Key, Value>::updateBalance(int8_t diff)
 template<class Key, class Value>
 AVLNode<Key, Value> *AVLNode<Key, Value>::getParent() const
 {
-    return static_cast<AVLNode<Key, Value>*>(this->parent_);
+    return static_cast<AVLNode<Key, Value>*>(Node<Key, Value>::getParent());
 }
 
 /**
@@ -107,7 +127,7 @@ AVLNode<Key, Value> *AVLNode<Key, Value>::getParent() const
 template<class Key, class Value>
 AVLNode<Key, Value> *AVLNode<Key, Value>::getLeft() const
 {
-    return static_cast<AVLNode<Key, Value>*>(this->left_);
+    return static_cast<AVLNode<Key, Value>*>(this->getChild(0));
 }
 
 /**
@@ -116,7 +136,7 @@ AVLNode<Key, Value> *AVLNode<Key, Value>::getLeft() const
 template<class Key, class Value>
 AVLNode<Key, Value> *AVLNode<Key, Value>::getRight() const
 {
-    return static_cast<AVLNode<Key, Value>*>(this->right_);
+    return static_cast<AVLNode<Key, Value>*>(this->getChild(1));
 }
 
 
@@ -131,17 +151,26 @@ template <class Key, class Value>
 class AVLTree : public BinarySearchTree<Key, Value>
 {
 public:
+    using BinarySearchTree<Key, Value>::insert;
     virtual void insert (const std::pair<const Key, Value> &new_item); // TODO
     virtual void remove(const Key& key);  // TODO
 protected:
     virtual void nodeSwap( AVLNode<Key,Value>* n1, AVLNode<Key,Value>* n2);
+    virtual Node<Key, Value>* insertAt(Node<Key, Value>* parent, bool isLeft, const std::pair<const Key, Value>& new_item);
+    void insertFix(AVLNode<Key, Value>* node);
 
     // Add helper functions here
     void rotateLeft(AVLNode<Key, Value>* top);
     void rotateRight(AVLNode<Key, Value>* top);
     void restructure(AVLNode<Key, Value>* node);
-    int height(AVLNode<Key, Value>* start);
     void removeFix( AVLNode<Key,Value>* node, int diff);
+    virtual void linkNode(Node<Key, Value>* parent, bool isLeft, Node<Key, Value>* node);
+    virtual void unlinkNode(Node<Key, Value>* node);
+    virtual void rebuiltNode(Node<Key, Value>* node, int leftHeight, int rightHeight);
+    // Called after every rotation, once top has become a child of child, so
+    // that trees keeping per-subtree data (see IntervalTree) can redo it for
+    // the two nodes whose subtrees changed
+    virtual void rotated(AVLNode<Key, Value>* top, AVLNode<Key, Value>* child);
 
 };
 
@@ -154,43 +183,41 @@ void AVLTree<Key, Value>::insert (const std::pair<const Key, Value> &new_item)
 {
     // TODO
 
+    //the shared descent finds the slot (or updates the value in place);
+    //insertAt links the new AVLNode and rebalances
+    BinarySearchTree<Key, Value>::insert(new_item);
+}
 
-    //case 1: no items in list:
-    if (this -> root_ == nullptr){
-        AVLNode<Key, Value>* nn = new AVLNode<Key, Value>(new_item.first, new_item.second, nullptr);
-        nn -> setBalance(0);
-        nn-> setLeft(nullptr);
-        nn -> setRight(nullptr);
-        this -> root_ = nn;
-        return;
-    }
-    //case 2: non-empty tree
-    AVLNode<Key, Value>* pn = static_cast<AVLNode<Key, Value>*>(this->root_); //parent_node
-    AVLNode<Key, Value>* cn = pn; //current_node
-    bool isLeft = false;
-    while (cn != nullptr){
-        pn = cn;
-        if (new_item.first > (cn -> getKey())){
-            cn = cn -> getRight();
-            isLeft = false;
-        } else if (new_item.first < (cn -> getKey())){
-            cn = cn -> getLeft();
-            isLeft = true;
-            int x =1;
-        } else {
-            cn -> setValue(new_item.second);
-            return;            
-        }
-    }
-    AVLNode<Key, Value>* new_node = new AVLNode<Key, Value>(new_item.first, new_item.second, pn);
-    if (isLeft){
-        pn -> setLeft(new_node);
-    } else{
-        pn -> setRight(new_node);
-    }
-
+/**
+* Links a new AVLNode into the given empty slot and rebalances.
+*/
+template<class Key, class Value>
+Node<Key, Value>* AVLTree<Key, Value>::insertAt(Node<Key, Value>* parent, bool isLeft, const std::pair<const Key, Value>& new_item)
+{
+    AVLNode<Key, Value>* new_node = new AVLNode<Key, Value>(new_item.first, new_item.second, static_cast<AVLNode<Key, Value>*>(parent), this -> itemStore());
+    BST_COUNT(allocations, 1);
+    linkNode(parent, isLeft, new_node);
+    return new_node;
+}
 
+/**
+* Links a leaf AVLNode into the given empty slot and rebalances. insertFix
+* resets its balance, so nodes from other trees can be linked too.
+*/
+template<class Key, class Value>
+void AVLTree<Key, Value>::linkNode(Node<Key, Value>* parent, bool isLeft, Node<Key, Value>* node)
+{
+    this -> attachNode(parent, isLeft, node);
+    insertFix(static_cast<AVLNode<Key, Value>*>(node));
+}
 
+/**
+* Walks up from a freshly linked leaf updating balances until a subtree's
+* height stops changing, restructuring at the first node that goes out of balance.
+*/
+template<class Key, class Value>
+void AVLTree<Key, Value>::insertFix(AVLNode<Key, Value>* new_node)
+{
     //now, we have inserted a new node to the bottom of our tree.
 
     new_node->setBalance(0);
@@ -219,6 +246,7 @@ void AVLTree<Key, Value>::insert (const std::pair<const Key, Value> &new_item)
 
 template <class Key, class Value>
 void AVLTree<Key, Value>::rotateRight(AVLNode<Key, Value>* top){
+    BST_COUNT(rotations, 1);
     bool isLeft = false;
     if (top -> getParent() != nullptr){
         if (top == top-> getParent()-> getLeft()){
@@ -254,14 +282,18 @@ void AVLTree<Key, Value>::rotateRight(AVLNode<Key, Value>* top){
 
 
     //the balance of each node is the diff between
-    //its right and left subtrees heights
+    //its right and left subtrees heights. Only top and child change, and
+    //their new balances follow from the old ones without measuring heights:
+    //top loses child and child's left subtree, then child gains top.
 
-    top -> setBalance(height(top -> getRight()) - height(top-> getLeft()));
-    child -> setBalance(height(child->getRight()) - height (child-> getLeft()));
+    top -> setBalance(top -> getBalance() + 1 - std::min<int>(child -> getBalance(), 0));
+    child -> setBalance(child -> getBalance() + 1 + std::max<int>(top -> getBalance(), 0));
+    rotated(top, child);
 
 }
 template <class Key, class Value>
 void AVLTree<Key, Value>::rotateLeft(AVLNode<Key, Value>* top){
+    BST_COUNT(rotations, 1);
     AVLNode<Key, Value>* child = top-> getRight();
     bool isLeft = false;
     if (top -> getParent() != nullptr){
@@ -290,29 +322,17 @@ void AVLTree<Key, Value>::rotateLeft(AVLNode<Key, Value>* top){
     }
 
     //the balance of each node is the diff between
-    //its right and left subtrees heights
+    //its right and left subtrees heights (mirror of rotateRight)
 
-    top -> setBalance(height(top -> getRight()) - height(top-> getLeft()));
-    child -> setBalance(height(child->getRight()) - height (child-> getLeft()));
+    top -> setBalance(top -> getBalance() - 1 - std::max<int>(child -> getBalance(), 0));
+    child -> setBalance(child -> getBalance() - 1 + std::min<int>(top -> getBalance(), 0));
+    rotated(top, child);
 
 }
 
-template<class Key, class Value>
-int AVLTree<Key, Value>:: height(AVLNode<Key, Value>* start){
-
-    if (start == nullptr){
-        return 0;
-    }
-
-    int lTree = height(start -> getLeft());
-    int rTree = height (start -> getRight());
-
-    return 1 + std::max(lTree, rTree);
-
-}
 template<class Key, class Value>
 void AVLTree<Key, Value>:: restructure(AVLNode<Key, Value>* node){
-  
+    BST_COUNT(restructures, 1);
     int pBalance = node -> getBalance();
     AVLNode<Key, Value>* child;
     int cBalance;
@@ -364,19 +384,21 @@ void AVLTree<Key, Value>:: remove(const Key& key)
 {
     //TODO
 
-    AVLNode<Key, Value>* cn = static_cast<AVLNode<Key, Value>*>(this -> root_);
-    while (cn != nullptr){
-        if (key > cn -> getKey()){
-            cn = cn-> getRight();
-        } else if (key < cn -> getKey()){
-            cn = cn -> getLeft();
-        } else {
-            break;
-        }
-    }
+    Node<Key, Value>* cn = this -> internalFind(key);
     if (cn == nullptr){ //key not found in tree
         return;
     }
+    this -> eraseNode(cn);
+}
+
+/**
+* Unlinks node, then rebalances from its old parent upwards.
+*/
+template<class Key, class Value>
+void AVLTree<Key, Value>::unlinkNode(Node<Key, Value>* node)
+{
+    AVLNode<Key, Value>* cn = static_cast<AVLNode<Key, Value>*>(node);
+    this -> retreatRightmost(cn);
 
 
     //At this point, the key was found in the tree and cn points to this node
@@ -403,15 +425,18 @@ void AVLTree<Key, Value>:: remove(const Key& key)
             this -> root_ = swap;
         }
         AVLNode<Key, Value>* parent = cn -> getParent();
+        //the predecessor never has a right child, but it may have a left one
+        AVLNode<Key, Value>* child = cn -> getLeft();
         if (cn == parent -> getRight()){
-            parent -> setRight(nullptr);
-            delete cn;
+            parent -> setRight(child);
            diff= -1;
         } else {
-            parent -> setLeft(nullptr);
-            delete cn;
+            parent -> setLeft(child);
             diff = 1;
         }
+        if (child != nullptr){
+            child -> setParent(parent);
+        }
 
         removeFix(parent, diff);
         return;
@@ -441,19 +466,16 @@ void AVLTree<Key, Value>:: remove(const Key& key)
                 }
                 diff = -1;
             }
-            delete cn;
             // if (parent != nullptr){
                 removeFix(parent, diff);
             
         } else { //cn is the first node of the tree
             if (child == nullptr){ //cn is the only node
-                delete cn;
                 this -> root_ = nullptr;
                 return;
             } else{ // child will be the only node
                 this -> root_ = child;
                 child -> setParent(nullptr);
-                delete cn;
                 return;
             }
 
@@ -465,119 +487,135 @@ void AVLTree<Key, Value>:: remove(const Key& key)
 
 template<class Key, class Value>
 void AVLTree<Key, Value>::removeFix( AVLNode<Key,Value>* node, int diff){
-    if (node == nullptr){
-        return;
-    }
-    AVLNode<Key, Value>* parent = node -> getParent();
-    int ndiff = 0;
-    if (parent != nullptr){
-        if (parent -> getLeft() == node){
-            ndiff = 1; //left child
-        } else {
-            ndiff = -1; //right child
-        }
-    }
-    if ((node -> getBalance() + diff ==-2 )||(node -> getBalance() + diff == 2 )){ //Case 1:
-        AVLNode<Key,Value>* c;
-        bool rRot = false;
-        if (node -> getBalance() + diff ==-2){   //requires right rotations
-            c = node -> getLeft();
-            rRot = true;
-        }  else {                               //requires left rotations
-            c = node -> getRight();
+    BST_COUNT(removeFixes, 1);
+    //each step either stops or moves one level up with the height change the
+    //parent sees, so this is a loop rather than recursion
+    while (node != nullptr){
+        AVLNode<Key, Value>* parent = node -> getParent();
+        int ndiff = 0;
+        if (parent != nullptr){
+            if (parent -> getLeft() == node){
+                ndiff = 1; //left child
+            } else {
+                ndiff = -1; //right child
+            }
         }
+        if ((node -> getBalance() + diff ==-2 )||(node -> getBalance() + diff == 2 )){ //Case 1:
+            AVLNode<Key,Value>* c;
+            bool rRot = false;
+            node -> setBalance(node -> getBalance() + diff);
+            if (node -> getBalance() ==-2){   //requires right rotations
+                c = node -> getLeft();
+                rRot = true;
+            }  else {                               //requires left rotations
+                c = node -> getRight();
+            }
         
 
       
-        //Case 1a:
-        if ((c -> getBalance() == -1 && rRot)|| (c-> getBalance() ==1 && !rRot)){
-            if (rRot){ //right rotation
-                rotateRight(node);
-            } else {             //left rotation
-                rotateLeft(node);
-            }
-            node -> setBalance(0);
-            c -> setBalance(0);
-            // if (parent != nullptr){
-                removeFix(parent, ndiff );
-
-            
-
-        //Case 1b:
-        } else if (c -> getBalance() == 0){
-
-            if (rRot){ //right rotation
-                rotateRight(node);
-                node -> setBalance(-1);
-                c -> setBalance(1);
-            } else{  //left rotation
-                rotateLeft(node);
-                node -> setBalance(1);
-                c -> setBalance(-1);
-            }
-            return;
-
-        //Case 1c:
-        } else if ((c -> getBalance() == 1 && rRot) || (c->getBalance() == -1 && !rRot)){
-            AVLNode<Key, Value>* g;
-            if (rRot){  //right rotation
-                g = c -> getRight();
-                rotateLeft(c);
-                rotateRight(node);
-                if (g== nullptr){
-                    return;
+            //Case 1a:
+            if ((c -> getBalance() == -1 && rRot)|| (c-> getBalance() ==1 && !rRot)){
+                if (rRot){ //right rotation
+                    rotateRight(node);
+                } else {             //left rotation
+                    rotateLeft(node);
                 }
-                if (g -> getBalance() ==1 ){
-                    node -> setBalance(0);
-                    c -> setBalance(-1);
-                    // g -> setBalance(0);
-                } else if (g -> getBalance() == 0){
-                    node -> setBalance(0);
-                    c -> setBalance(0);
-                    // g -> setBalance(0);
-                } else if (g -> getBalance() == -1){
+                node -> setBalance(0);
+                c -> setBalance(0);
+                node = parent;
+                diff = ndiff;
+                continue;
+
+            //Case 1b:
+            } else if (c -> getBalance() == 0){
+
+                if (rRot){ //right rotation
+                    rotateRight(node);
+                    node -> setBalance(-1);
+                    c -> setBalance(1);
+                } else{  //left rotation
+                    rotateLeft(node);
                     node -> setBalance(1);
-                    c -> setBalance(0);
-                    // g -> setBalance(0);
+                    c -> setBalance(-1);
                 }
-                g -> setBalance(0);
-            }else{  //left rotation
-                g = c -> getLeft();
-                rotateRight(c);
-                rotateLeft(node);
-                if (g -> getBalance() ==1 ){
-                    node -> setBalance(0); //og = 0
-                    c -> setBalance(1); //og = 1
+                return;
+
+            //Case 1c:
+            } else if ((c -> getBalance() == 1 && rRot) || (c->getBalance() == -1 && !rRot)){
+                AVLNode<Key, Value>* g;
+                if (rRot){  //right rotation
+                    g = c -> getRight();
+                    //the fix-up depends on g's balance before the rotations
+                    int8_t gBalance = g -> getBalance();
+                    rotateLeft(c);
+                    rotateRight(node);
+                    if (gBalance ==1 ){
+                        node -> setBalance(0);
+                        c -> setBalance(-1);
+                    } else if (gBalance == 0){
+                        node -> setBalance(0);
+                        c -> setBalance(0);
+                    } else if (gBalance == -1){
+                        node -> setBalance(1);
+                        c -> setBalance(0);
+                    }
                     g -> setBalance(0);
-                } else if (g -> getBalance() == 0){
-                    node -> setBalance(0);
-                    c -> setBalance(0);
+                }else{  //left rotation
+                    g = c -> getLeft();
+                    int8_t gBalance = g -> getBalance();
+                    rotateRight(c);
+                    rotateLeft(node);
+                    if (gBalance ==1 ){
+                        node -> setBalance(-1);
+                        c -> setBalance(0);
+                    } else if (gBalance == 0){
+                        node -> setBalance(0);
+                        c -> setBalance(0);
+                    } else if (gBalance == -1){
+                        node -> setBalance(0);
+                        c -> setBalance(1);
+                    }
                     g -> setBalance(0);
-                } else if (g -> getBalance() == -1){
-                    node -> setBalance(-1); //og = -1
-                    c -> setBalance(0); //og =0
-                    g -> setBalance(0); //og = 0
                 }
+                node = parent;
+                diff = ndiff;
+                continue;
             }
-            removeFix(parent, ndiff);
-        }
+            return;
 
-    } else if (node -> getBalance()  + diff == -1 || node -> getBalance() + diff == 1){ //Case 2
-        if (node -> getBalance() == 1){
-            node -> setBalance(1);
-        }else {
-            node -> setBalance(-1);
+        } else if (node -> getBalance()  + diff == -1 || node -> getBalance() + diff == 1){ //Case 2
+            node -> setBalance(node -> getBalance() + diff);
+            return;
+        } else if (node -> getBalance() + diff == 0){ //Case 3
+            node -> setBalance(0);
+            node = parent;
+            diff = ndiff;
+            continue;
         }
         return;
-    } else if (node -> getBalance() + diff == 0){ //Case 3
-        node -> setBalance(0);
-        removeFix(parent, ndiff);   
-        return;
     }
 
  }
 
 
+/**
+* A node placed by linkBalanced gets the balance of its new subtrees.
+*/
+template<class Key, class Value>
+void AVLTree<Key, Value>::rebuiltNode(Node<Key, Value>* node, int leftHeight, int rightHeight)
+{
+    static_cast<AVLNode<Key, Value>*>(node) -> setBalance((int8_t)(rightHeight - leftHeight));
+}
+
+/**
+* The plain AVL tree keeps nothing per subtree.
+*/
+template<class Key, class Value>
+void AVLTree<Key, Value>::rotated(AVLNode<Key, Value>* top, AVLNode<Key, Value>* child)
+{
+
+}
+
 template<class Key, class Value>
 void AVLTree<Key, Value>::nodeSwap( AVLNode<Key,Value>* n1, AVLNode<Key,Value>* n2)
 {
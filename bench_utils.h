@@ -0,0 +1,183 @@
+#ifndef BENCH_UTILS_H
+#define BENCH_UTILS_H
+
+#include <random>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <cstdint>
+#include <cmath>
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+// Key generation and timing helpers shared by the tree benchmarks.
+// Modelled on the CS104 test suite's random_generator.h: every generator
+// is deterministic for a given seed so runs can be compared.
+
+// type for random seeds
+typedef uint32_t RandomSeed;
+
+// The key orders a benchmark can be run with.
+enum class KeyOrder
+{
+    UNIFORM,        // the keys 0..count-1 in random order
+    SORTED,         // 0, 1, 2, ...
+    REVERSE_SORTED  // count-1, count-2, ...
+};
+
+inline const char* keyOrderName(KeyOrder order)
+{
+    switch(order)
+    {
+        case KeyOrder::UNIFORM: return "uniform";
+        case KeyOrder::SORTED: return "sorted";
+        case KeyOrder::REVERSE_SORTED: return "reverse";
+    }
+    return "?";
+}
+
+// Generates count distinct keys (0..count-1) in the given order.
+template<typename IntType>
+std::vector<IntType> makeKeyVector(size_t count, KeyOrder order, RandomSeed seed)
+{
+    std::vector<IntType> keys;
+    keys.reserve(count);
+    for(size_t i = 0; i < count; ++i)
+    {
+        keys.push_back(static_cast<IntType>(i));
+    }
+
+    if(order == KeyOrder::REVERSE_SORTED)
+    {
+        std::reverse(keys.begin(), keys.end());
+    }
+    else if(order == KeyOrder::UNIFORM)
+    {
+        std::mt19937 randEngine;
+        randEngine.seed(seed);
+        std::shuffle(keys.begin(), keys.end(), randEngine);
+    }
+
+    return keys;
+}
+
+// Generates count draws from a Zipfian distribution over the keys 0..universe-1:
+// the k-th most popular key is chosen with probability proportional to 1/k^skew.
+// Popularity ranks are assigned to keys in random order, so hot keys are spread
+// across the key space instead of all being the smallest ones.
+// Duplicates are expected (that is the point).
+template<typename IntType>
+std::vector<IntType> makeZipfianKeyVector(size_t count, size_t universe, double skew, RandomSeed seed)
+{
+    std::mt19937 randEngine;
+    randEngine.seed(seed);
+
+    // cumulative popularity of ranks 1..universe
+    std::vector<double> cdf(universe);
+    double total = 0;
+    for(size_t rank = 0; rank < universe; ++rank)
+    {
+        total += 1.0 / std::pow((double)(rank + 1), skew);
+        cdf[rank] = total;
+    }
+
+    std::vector<IntType> rankToKey = makeKeyVector<IntType>(universe, KeyOrder::UNIFORM, seed + 1);
+
+    std::uniform_real_distribution<double> distributor(0, total);
+    std::vector<IntType> keys;
+    keys.reserve(count);
+    while(keys.size() < count)
+    {
+        size_t rank = std::lower_bound(cdf.begin(), cdf.end(), distributor(randEngine)) - cdf.begin();
+        if(rank >= universe)
+        {
+            rank = universe - 1;
+        }
+        keys.push_back(rankToKey[rank]);
+    }
+
+    return keys;
+}
+
+// Generates count distinct URL-like strings in random order, shaped like a
+// crawl or access log: a few hosts get most of the pages, paths are two to
+// four segments deep, and every URL ends in a unique numeric id. Keys therefore
+// share long prefixes ("https://www.host.com/section/...").
+inline std::vector<std::string> makeUrlKeyVector(size_t count, RandomSeed seed)
+{
+    static const char* const hosts[] = {
+        "shop.example", "news.example", "docs.example", "forum.example",
+        "cdn.example", "blog.example", "wiki.example", "api.example"
+    };
+    static const char* const segments[] = {
+        "products", "category", "articles", "2023", "2024", "users", "images",
+        "static", "search", "tags", "reviews", "downloads", "en-us", "archive"
+    };
+    const size_t numHosts = sizeof(hosts) / sizeof(hosts[0]);
+    const size_t numSegments = sizeof(segments) / sizeof(segments[0]);
+
+    std::vector<int> hostPicks = makeZipfianKeyVector<int>(count, numHosts, 1.0, seed);
+    std::mt19937 randEngine;
+    randEngine.seed(seed + 2);
+    std::vector<std::string> urls;
+    urls.reserve(count);
+    for(size_t i = 0; i < count; ++i)
+    {
+        std::string url = "https://www.";
+        url += hosts[hostPicks[i]];
+        url += ".com";
+        size_t depth = 2 + randEngine() % 3;
+        for(size_t d = 0; d < depth; ++d)
+        {
+            url += '/';
+            url += segments[randEngine() % numSegments];
+        }
+        url += "/item-";
+        url += std::to_string(i);
+        urls.push_back(url);
+    }
+    std::shuffle(urls.begin(), urls.end(), randEngine);
+    return urls;
+}
+
+// Simple wall-clock stopwatch. Reports nanoseconds.
+class BenchClock
+{
+public:
+    BenchClock():
+    start_(std::chrono::steady_clock::now())
+    {
+    }
+
+    void restart()
+    {
+        start_ = std::chrono::steady_clock::now();
+    }
+
+    uint64_t elapsedNs() const
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_).count();
+    }
+
+private:
+    std::chrono::steady_clock::time_point start_;
+};
+
+// Bytes of heap memory currently allocated, counting each block as the
+// allocator holds it (size rounded up, header included), or 0 where this is
+// unknown (only glibc 2.33+ reports it). The difference between two calls
+// is what a data structure built in between really takes, even when it
+// reuses memory freed earlier.
+inline uint64_t allocatedBytes()
+{
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+    struct mallinfo2 info = mallinfo2();
+    return info.uordblks + info.hblkhd;
+#else
+    return 0;
+#endif
+}
+
+#endif
@@ -0,0 +1,213 @@
+#include <iostream>
+#include <vector>
+#include <map>
+#include <string>
+#include <cstring>
+#include <cstdlib>
+#include "bst.h"
+#include "avlbst.h"
+#include "rbbst.h"
+#include "splaybst.h"
+#include "scapegoatbst.h"
+#include "bench_utils.h"
+
+using namespace std;
+
+// Benchmark suite comparing the tree engines with std::map.
+// Usage: ./bst-bench-suite [maxN] [engine...]
+// Runs insert, find, remove, a full iteration and clear for every engine and
+// key order at n = 10^3, 10^4, ... up to maxN (default 10^6; 10^8 needs
+// around 10GB of memory), and prints one CSV row per measurement:
+//   engine,order,op,n,reps,ns_per_op
+// Rows are in a fixed order so the output of two versions can be diffed.
+// Small sizes are repeated (reps) so every row times at least ~10^5 operations.
+//
+// "zipf" draws every inserted, looked-up and removed key from a Zipfian
+// distribution over 0..n-1, so most inserts are updates of hot keys.
+// The unbalanced BST is skipped for sorted and reverse inputs above
+// DEGENERATE_MAX_N, where it degrades to a list and each run takes O(n^2).
+
+static const size_t DEGENERATE_MAX_N = 10000;
+
+static volatile long benchSink;
+
+// Adapters so std::map and the trees can be driven by the same code
+template<typename Tree>
+void benchInsert(Tree& tree, int key, int value)
+{
+    tree.insert(std::make_pair(key, value));
+}
+
+void benchInsert(map<int, int>& tree, int key, int value)
+{
+    tree[key] = value;
+}
+
+template<typename Tree>
+void benchRemove(Tree& tree, int key)
+{
+    tree.remove(key);
+}
+
+void benchRemove(map<int, int>& tree, int key)
+{
+    tree.erase(key);
+}
+
+struct Timings
+{
+    uint64_t insertNs, findNs, removeNs, iterateNs, clearNs;
+    size_t iterated;
+};
+
+// One build/find/iterate/clear run and one build/remove run over keys
+template<typename Tree>
+void runOnce(vector<int> const & keys, Timings& total)
+{
+    BenchClock clock;
+    long sum = 0;
+    {
+        Tree tree;
+        for(size_t i = 0; i < keys.size(); ++i)
+        {
+            benchInsert(tree, keys[i], (int)i);
+        }
+        total.insertNs += clock.elapsedNs();
+
+        clock.restart();
+        for(size_t i = 0; i < keys.size(); ++i)
+        {
+            sum += tree.find(keys[i])->second;
+        }
+        total.findNs += clock.elapsedNs();
+
+        clock.restart();
+        size_t count = 0;
+        for(typename Tree::iterator it = tree.begin(); it != tree.end(); ++it)
+        {
+            sum += it->second;
+            ++count;
+        }
+        total.iterateNs += clock.elapsedNs();
+        total.iterated += count;
+
+        clock.restart();
+        tree.clear();
+        total.clearNs += clock.elapsedNs();
+    }
+
+    {
+        Tree tree;
+        for(size_t i = 0; i < keys.size(); ++i)
+        {
+            benchInsert(tree, keys[i], (int)i);
+        }
+        clock.restart();
+        for(size_t i = 0; i < keys.size(); ++i)
+        {
+            benchRemove(tree, keys[i]);
+        }
+        total.removeNs += clock.elapsedNs();
+    }
+    benchSink = sum;
+}
+
+static void printRow(const char* engine, const char* order, const char* op, size_t n, size_t reps, uint64_t ns, size_t ops)
+{
+    cout << engine << ',' << order << ',' << op << ',' << n << ',' << reps << ','
+         << (ops == 0 ? 0.0 : (double)ns / ops) << '\n';
+}
+
+template<typename Tree>
+void benchEngine(const char* engine, const char* order, vector<int> const & keys)
+{
+    size_t n = keys.size();
+    size_t reps = std::max((size_t)1, (size_t)100000 / n);
+
+    Timings total = Timings();
+    for(size_t rep = 0; rep < reps; ++rep)
+    {
+        runOnce<Tree>(keys, total);
+    }
+
+    size_t ops = n * reps;
+    printRow(engine, order, "insert", n, reps, total.insertNs, ops);
+    printRow(engine, order, "find", n, reps, total.findNs, ops);
+    printRow(engine, order, "remove", n, reps, total.removeNs, ops);
+    printRow(engine, order, "iterate", n, reps, total.iterateNs, total.iterated);
+    // clear is reported per node removed, like iterate
+    printRow(engine, order, "clear", n, reps, total.clearNs, total.iterated);
+    cout.flush();
+}
+
+static bool wanted(int argc, char* argv[], const char* engine)
+{
+    if(argc <= 2)
+    {
+        return true;
+    }
+    for(int i = 2; i < argc; ++i)
+    {
+        if(strcmp(argv[i], engine) == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t maxN = 1000000;
+    if(argc > 1)
+    {
+        maxN = strtoull(argv[1], NULL, 10);
+    }
+
+    cout << "engine,order,op,n,reps,ns_per_op" << endl;
+    for(size_t n = 1000; n <= maxN; n *= 10)
+    {
+        const char* orderNames[] = {"uniform", "sorted", "reverse", "zipf"};
+        for(int o = 0; o < 4; ++o)
+        {
+            vector<int> keys;
+            if(o == 3)
+            {
+                keys = makeZipfianKeyVector<int>(n, n, 1.0, 341);
+            }
+            else
+            {
+                KeyOrder orders[] = {KeyOrder::UNIFORM, KeyOrder::SORTED, KeyOrder::REVERSE_SORTED};
+                keys = makeKeyVector<int>(n, orders[o], 340);
+            }
+            const char* order = orderNames[o];
+
+            if(wanted(argc, argv, "bst") && (o == 0 || o == 3 || n <= DEGENERATE_MAX_N))
+            {
+                benchEngine<BinarySearchTree<int, int> >("bst", order, keys);
+            }
+            if(wanted(argc, argv, "avl"))
+            {
+                benchEngine<AVLTree<int, int> >("avl", order, keys);
+            }
+            if(wanted(argc, argv, "rb"))
+            {
+                benchEngine<RedBlackTree<int, int> >("rb", order, keys);
+            }
+            if(wanted(argc, argv, "splay"))
+            {
+                benchEngine<SplayTree<int, int> >("splay", order, keys);
+            }
+            if(wanted(argc, argv, "sgt"))
+            {
+                benchEngine<ScapegoatTree<int, int> >("sgt", order, keys);
+            }
+            if(wanted(argc, argv, "map"))
+            {
+                benchEngine<map<int, int> >("map", order, keys);
+            }
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,567 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <random>
+#include <cstdlib>
+#include <string>
+#include <fstream>
+#include "bst.h"
+#include "avlbst.h"
+#include "rbbst.h"
+#include "splaybst.h"
+#include "scapegoatbst.h"
+#include "intervalbst.h"
+#include "bench_utils.h"
+#include "latency_histogram.h"
+
+using namespace std;
+
+// Head-to-head benchmark of the balanced tree engines.
+// Usage: ./bst-bench [numKeys] [urlFile]
+// Prints one line per (engine, key order, operation): the average ns/op.
+// The "zipf" lines time lookups drawn from a skewed (Zipfian) distribution
+// against a tree holding numKeys uniformly inserted keys.
+// The "append" lines insert increasing keys, which take the rightmost fast
+// path, and "hinted" does the same through insert(end(), item).
+// The "batch" lines compare lookups per second of a find() loop against
+// findMany() for batch sizes 1..1024.
+// The "cleanup" lines delete 10/30/60% of the keys by predicate three ways:
+// remove(key) per match, erase(iterator) during the scan, and eraseIf.
+// The "counter" lines bump a counter per Zipfian key (the first bump of a key
+// inserts it) with find() followed by insert(), and with a single upsert().
+// The "memory" lines give the heap memory a uniformly built tree takes per
+// node (allocator overhead included) next to sizeof its node, then the
+// cost of looking up every key in random order. Build with
+// make DEFS=-DAVL_TAGGED_BALANCE to compare the AVL node layouts.
+// The "wide" lines do the same with 256-byte values, which is where
+// make DEFS=-DBST_COLD_VALUE_BYTES=64 (values kept out of the nodes) helps.
+// The "url" lines insert and look up URL-like string keys, generated (see
+// makeUrlKeyVector) or read one per line from urlFile, with the string
+// search that skips shared prefixes ("find") and with the plain compare
+// loop on the same strings ("find-cmp").
+// The "interval" lines look up which of numKeys time ranges (mostly short,
+// a few long) overlap a short window, by scanning from begin() as a plain
+// tree keyed by start has to ("scan"), and with IntervalTree's
+// findOverlapping ("query"); "found" is the average number of matches.
+// The "latency" lines give the per-call p50/p90/p99/max of each operation
+// for a uniform workload, to show the tail that averages hide.
+
+static volatile long benchSink;
+
+static void report(const char* engine, KeyOrder order, const char* op, size_t n, uint64_t ns, size_t ops)
+{
+    cout << left << setw(8) << engine << setw(10) << keyOrderName(order) << setw(8) << op
+         << right << setw(10) << n << setw(12) << fixed << setprecision(1) << ((double)ns / ops) << " ns/op" << endl;
+}
+
+template<typename Tree>
+void benchTree(const char* engine, KeyOrder order, vector<int> const & keys)
+{
+    Tree tree;
+    BenchClock clock;
+
+    for(size_t i = 0; i < keys.size(); ++i)
+    {
+        tree.insert(std::make_pair(keys[i], (int)i));
+    }
+    report(engine, order, "insert", keys.size(), clock.elapsedNs(), keys.size());
+
+    clock.restart();
+    long sum = 0;
+    for(size_t i = 0; i < keys.size(); ++i)
+    {
+        sum += tree.find(keys[i])->second;
+    }
+    benchSink = sum;
+    report(engine, order, "find", keys.size(), clock.elapsedNs(), keys.size());
+
+    // remove-heavy churn: delete a live key and insert a fresh one
+    mt19937 randEngine(7);
+    vector<int> live(keys);
+    int nextKey = (int)keys.size();
+    clock.restart();
+    for(size_t i = 0; i < keys.size(); ++i)
+    {
+        size_t victim = randEngine() % live.size();
+        tree.remove(live[victim]);
+        live[victim] = nextKey;
+        tree.insert(std::make_pair(nextKey++, 0));
+    }
+    report(engine, order, "churn", keys.size(), clock.elapsedNs(), keys.size());
+
+    clock.restart();
+    for(size_t i = 0; i < live.size(); ++i)
+    {
+        tree.remove(live[i]);
+    }
+    report(engine, order, "remove", keys.size(), clock.elapsedNs(), keys.size());
+}
+
+template<typename Tree, typename NodeType>
+void benchMemory(const char* engine, vector<int> const & keys)
+{
+    uint64_t before = allocatedBytes();
+    Tree tree;
+    for(size_t i = 0; i < keys.size(); ++i)
+    {
+        tree.insert(std::make_pair(keys[i], (int)i));
+    }
+    uint64_t grown = allocatedBytes() - before;
+    cout << left << setw(8) << engine << setw(10) << "uniform" << setw(8) << "memory"
+         << right << setw(10) << keys.size() << setw(12) << fixed << setprecision(1)
+         << ((double)grown / keys.size()) << " B/node (sizeof " << sizeof(NodeType) << ")" << endl;
+
+    // a different order than the inserts, so lookups do not follow allocation order
+    vector<int> lookups(keys);
+    mt19937 randEngine(11);
+    shuffle(lookups.begin(), lookups.end(), randEngine);
+    BenchClock clock;
+    long sum = 0;
+    for(size_t i = 0; i < lookups.size(); ++i)
+    {
+        sum += tree.find(lookups[i])->second;
+    }
+    benchSink = sum;
+    report(engine, KeyOrder::UNIFORM, "find", keys.size(), clock.elapsedNs(), keys.size());
+}
+
+// A value too big to share a cache line with the links
+struct WideValue
+{
+    WideValue(int v = 0) : value(v)
+    {
+    }
+
+    int value;
+    char payload[252];
+};
+
+// print() is compiled for every tree, so values must be printable
+ostream& operator<<(ostream& out, WideValue const & wide)
+{
+    return out << wide.value;
+}
+
+template<typename Tree>
+void benchWideFind(const char* engine, vector<int> const & keys)
+{
+    Tree tree;
+    for(size_t i = 0; i < keys.size(); ++i)
+    {
+        tree.insert(std::make_pair(keys[i], WideValue((int)i)));
+    }
+
+    vector<int> lookups(keys);
+    mt19937 randEngine(11);
+    shuffle(lookups.begin(), lookups.end(), randEngine);
+    BenchClock clock;
+    long sum = 0;
+    for(size_t i = 0; i < lookups.size(); ++i)
+    {
+        sum += tree.find(lookups[i])->second.value;
+    }
+    benchSink = sum;
+    cout << left << setw(8) << engine << setw(10) << "wide" << setw(8) << "find"
+         << right << setw(10) << keys.size() << setw(12) << fixed << setprecision(1)
+         << ((double)clock.elapsedNs() / lookups.size()) << " ns/op" << endl;
+}
+
+void benchIntervals(vector<int> const & keys)
+{
+    IntervalTree<int, int> tree;
+    mt19937 randEngine(14);
+    for(size_t i = 0; i < keys.size(); ++i)
+    {
+        int start = keys[i] * 10;
+        int length = (i % 100 == 0) ? (int)(randEngine() % 10000) : (int)(randEngine() % 100);
+        tree.insert(std::make_pair(Interval<int>(start, start + length), (int)i));
+    }
+
+    // a scan visits half the tree on average, so it gets fewer windows
+    const int width = 50;
+    size_t numQueries = 10000;
+    size_t numScans = std::max<size_t>(10, std::min<size_t>(numQueries, 20000000 / (keys.size() + 1)));
+    vector<int> windows;
+    for(size_t i = 0; i < numQueries; ++i)
+    {
+        windows.push_back((int)(randEngine() % (10 * keys.size() + 1)));
+    }
+
+    BenchClock clock;
+    size_t found = 0;
+    for(size_t i = 0; i < numScans; ++i)
+    {
+        int low = windows[i];
+        int high = low + width;
+        for(IntervalTree<int, int>::iterator it = tree.begin(); it != tree.end() && it->first.low <= high; ++it)
+        {
+            found += (it->first.high >= low);
+        }
+    }
+    uint64_t scanNs = clock.elapsedNs();
+    benchSink = found;
+
+    clock.restart();
+    vector<IntervalTree<int, int>::iterator> matches;
+    found = 0;
+    for(size_t i = 0; i < numQueries; ++i)
+    {
+        tree.findOverlapping(windows[i], windows[i] + width, matches);
+        found += matches.size();
+    }
+    uint64_t queryNs = clock.elapsedNs();
+
+    cout << left << setw(8) << "avl" << setw(10) << "interval" << setw(8) << "scan"
+         << right << setw(10) << keys.size() << setw(12) << fixed << setprecision(1)
+         << ((double)scanNs / numScans) << " ns/op" << endl;
+    cout << left << setw(8) << "avl" << setw(10) << "interval" << setw(8) << "query"
+         << right << setw(10) << keys.size() << setw(12) << fixed << setprecision(1)
+         << ((double)queryNs / numQueries) << " ns/op  (found " << setprecision(1)
+         << ((double)found / numQueries) << ")" << endl;
+}
+
+// std::string keys the trees do not recognise as strings, so they search
+// with the generic compare loop
+struct PlainString
+{
+    PlainString(std::string const & s = std::string()) : text(s)
+    {
+    }
+
+    bool operator<(PlainString const & other) const { return text < other.text; }
+    bool operator>(PlainString const & other) const { return text > other.text; }
+    bool operator==(PlainString const & other) const { return text == other.text; }
+
+    std::string text;
+};
+
+ostream& operator<<(ostream& out, PlainString const & key)
+{
+    return out << key.text;
+}
+
+template<typename KeyType>
+void benchUrls(const char* engine, const char* op, vector<string> const & urls)
+{
+    vector<KeyType> keys(urls.begin(), urls.end());
+    vector<KeyType> lookups(keys);
+    mt19937 randEngine(13);
+    shuffle(lookups.begin(), lookups.end(), randEngine);
+
+    AVLTree<KeyType, int> tree;
+    BenchClock clock;
+    for(size_t i = 0; i < keys.size(); ++i)
+    {
+        tree.insert(std::make_pair(keys[i], (int)i));
+    }
+    uint64_t insertNs = clock.elapsedNs();
+
+    clock.restart();
+    long sum = 0;
+    for(size_t i = 0; i < lookups.size(); ++i)
+    {
+        sum += tree.find(lookups[i])->second;
+    }
+    benchSink = sum;
+    uint64_t findNs = clock.elapsedNs();
+
+    cout << left << setw(8) << engine << setw(10) << "url" << setw(8) << "insert"
+         << right << setw(10) << keys.size() << setw(12) << fixed << setprecision(1)
+         << ((double)insertNs / keys.size()) << " ns/op  (" << op << " loop)" << endl;
+    cout << left << setw(8) << engine << setw(10) << "url" << setw(8) << op
+         << right << setw(10) << keys.size() << setw(12) << fixed << setprecision(1)
+         << ((double)findNs / lookups.size()) << " ns/op" << endl;
+}
+
+// One URL per line; blank lines are skipped
+static bool readUrls(const char* filename, vector<string>& urls)
+{
+    ifstream in(filename);
+    string line;
+    while(getline(in, line))
+    {
+        if(!line.empty())
+        {
+            urls.push_back(line);
+        }
+    }
+    return !in.bad() && !urls.empty();
+}
+
+template<typename Tree>
+void benchSkewedFind(const char* engine, vector<int> const & keys, vector<int> const & lookups)
+{
+    Tree tree;
+    for(size_t i = 0; i < keys.size(); ++i)
+    {
+        tree.insert(std::make_pair(keys[i], (int)i));
+    }
+
+    BenchClock clock;
+    long sum = 0;
+    for(size_t i = 0; i < lookups.size(); ++i)
+    {
+        sum += tree.find(lookups[i])->second;
+    }
+    benchSink = sum;
+    cout << left << setw(8) << engine << setw(10) << "zipf" << setw(8) << "find"
+         << right << setw(10) << keys.size() << setw(12) << fixed << setprecision(1)
+         << ((double)clock.elapsedNs() / lookups.size()) << " ns/op" << endl;
+}
+
+template<typename Tree>
+void benchAppend(const char* engine, vector<int> const & keys)
+{
+    BenchClock clock;
+    {
+        Tree tree;
+        for(size_t i = 0; i < keys.size(); ++i)
+        {
+            tree.insert(std::make_pair(keys[i], (int)i));
+        }
+        report(engine, KeyOrder::SORTED, "append", keys.size(), clock.elapsedNs(), keys.size());
+    }
+
+    clock.restart();
+    {
+        Tree tree;
+        for(size_t i = 0; i < keys.size(); ++i)
+        {
+            tree.insert(tree.end(), std::make_pair(keys[i], (int)i));
+        }
+        report(engine, KeyOrder::SORTED, "hinted", keys.size(), clock.elapsedNs(), keys.size());
+    }
+}
+
+template<typename Tree>
+void benchBatchFind(const char* engine, vector<int> const & keys)
+{
+    Tree tree;
+    for(size_t i = 0; i < keys.size(); ++i)
+    {
+        tree.insert(std::make_pair(keys[i], (int)i));
+    }
+
+    vector<int> lookups = makeKeyVector<int>(keys.size(), KeyOrder::UNIFORM, 106);
+    vector<typename Tree::iterator> found;
+
+    for(size_t batch = 1; batch <= 1024; batch *= 2)
+    {
+        BenchClock clock;
+        long sum = 0;
+        for(size_t i = 0; i < lookups.size(); ++i)
+        {
+            sum += tree.find(lookups[i])->second;
+        }
+        uint64_t loopNs = clock.elapsedNs();
+
+        clock.restart();
+        vector<int> keyBatch;
+        for(size_t first = 0; first < lookups.size(); first += batch)
+        {
+            keyBatch.assign(lookups.begin() + first, lookups.begin() + std::min(first + batch, lookups.size()));
+            tree.findMany(keyBatch, found);
+            for(size_t i = 0; i < found.size(); ++i)
+            {
+                sum += found[i]->second;
+            }
+        }
+        uint64_t batchNs = clock.elapsedNs();
+        benchSink = sum;
+
+        cout << left << setw(8) << engine << setw(10) << "batch" << setw(8) << batch
+             << right << setw(10) << keys.size() << fixed << setprecision(2)
+             << setw(10) << (lookups.size() * 1000.0 / loopNs) << " Mfind/s"
+             << setw(10) << (lookups.size() * 1000.0 / batchNs) << " Mbatch/s" << endl;
+    }
+}
+
+template<typename Tree>
+void fillTree(Tree& tree, vector<int> const & keys)
+{
+    for(size_t i = 0; i < keys.size(); ++i)
+    {
+        tree.insert(std::make_pair(keys[i], (int)i));
+    }
+}
+
+template<typename Tree>
+void benchCleanup(const char* engine, vector<int> const & keys)
+{
+    int percents[] = {10, 30, 60};
+    for(int percent : percents)
+    {
+        // values are insertion indices, so this picks a fixed random subset
+        auto expired = [percent](std::pair<const int, int> const & item)
+        {
+            return (unsigned)item.second * 2654435761u % 100 < (unsigned)percent;
+        };
+
+        Tree byKey;
+        fillTree(byKey, keys);
+        BenchClock clock;
+        vector<int> doomed;
+        for(typename Tree::iterator it = byKey.begin(); it != byKey.end(); ++it)
+        {
+            if(expired(*it))
+            {
+                doomed.push_back(it->first);
+            }
+        }
+        for(size_t i = 0; i < doomed.size(); ++i)
+        {
+            byKey.remove(doomed[i]);
+        }
+        uint64_t removeNs = clock.elapsedNs();
+
+        Tree byIterator;
+        fillTree(byIterator, keys);
+        clock.restart();
+        for(typename Tree::iterator it = byIterator.begin(); it != byIterator.end(); )
+        {
+            it = expired(*it) ? byIterator.erase(it) : ++it;
+        }
+        uint64_t eraseNs = clock.elapsedNs();
+
+        Tree byPredicate;
+        fillTree(byPredicate, keys);
+        clock.restart();
+        byPredicate.eraseIf(expired);
+        uint64_t eraseIfNs = clock.elapsedNs();
+
+        cout << left << setw(8) << engine << setw(10) << "cleanup" << setw(8) << (to_string(percent) + "%")
+             << right << setw(10) << keys.size() << fixed << setprecision(2)
+             << setw(10) << removeNs / 1e6 << " ms remove"
+             << setw(10) << eraseNs / 1e6 << " ms erase"
+             << setw(10) << eraseIfNs / 1e6 << " ms eraseIf" << endl;
+    }
+}
+
+template<typename Tree>
+void benchCounters(const char* engine, vector<int> const & lookups)
+{
+    BenchClock clock;
+    long sum = 0;
+    {
+        Tree tree;
+        for(size_t i = 0; i < lookups.size(); ++i)
+        {
+            typename Tree::iterator it = tree.find(lookups[i]);
+            int count = (it == tree.end()) ? 0 : it->second;
+            tree.insert(std::make_pair(lookups[i], count + 1));
+        }
+        sum += tree.find(lookups[0])->second;
+    }
+    uint64_t twoDescentNs = clock.elapsedNs();
+
+    clock.restart();
+    {
+        Tree tree;
+        for(size_t i = 0; i < lookups.size(); ++i)
+        {
+            tree.upsert(lookups[i], 0, [](int& count) { ++count; });
+        }
+        sum += tree.find(lookups[0])->second;
+    }
+    uint64_t upsertNs = clock.elapsedNs();
+    benchSink = sum;
+
+    cout << left << setw(8) << engine << setw(10) << "counter" << setw(8) << "find+ins"
+         << right << setw(10) << lookups.size() << setw(12) << fixed << setprecision(1)
+         << ((double)twoDescentNs / lookups.size()) << " ns/op" << endl;
+    cout << left << setw(8) << engine << setw(10) << "counter" << setw(8) << "upsert"
+         << right << setw(10) << lookups.size() << setw(12) << fixed << setprecision(1)
+         << ((double)upsertNs / lookups.size()) << " ns/op" << endl;
+}
+
+template<template<typename, typename> class Tree>
+void benchLatency(const char* engine, vector<int> const & keys)
+{
+    LatencyTrackedTree<Tree, int, int> tree;
+    for(size_t i = 0; i < keys.size(); ++i)
+    {
+        tree.insert(std::make_pair(keys[i], (int)i));
+    }
+    long sum = 0;
+    for(size_t i = 0; i < keys.size(); ++i)
+    {
+        sum += tree.find(keys[i])->second;
+    }
+    benchSink = sum;
+    for(size_t i = 0; i < keys.size(); ++i)
+    {
+        tree.remove(keys[i]);
+    }
+
+    string prefix = string("latency engine=") + engine + " n=" + to_string(keys.size());
+    tree.printLatency(cout, prefix.c_str());
+}
+
+int main(int argc, char *argv[])
+{
+    size_t n = 100000;
+    if(argc > 1)
+    {
+        n = strtoul(argv[1], NULL, 10);
+    }
+
+    KeyOrder orders[] = {KeyOrder::UNIFORM, KeyOrder::SORTED, KeyOrder::REVERSE_SORTED};
+    for(KeyOrder order : orders)
+    {
+        vector<int> keys = makeKeyVector<int>(n, order, 104);
+        benchTree<AVLTree<int, int> >("avl", order, keys);
+        benchTree<RedBlackTree<int, int> >("rb", order, keys);
+        benchTree<SplayTree<int, int> >("splay", order, keys);
+        benchTree<ScapegoatTree<int, int> >("sgt", order, keys);
+    }
+
+    vector<int> sortedKeys = makeKeyVector<int>(n, KeyOrder::SORTED, 104);
+    benchAppend<BinarySearchTree<int, int> >("bst", sortedKeys);
+    benchAppend<AVLTree<int, int> >("avl", sortedKeys);
+
+    benchBatchFind<AVLTree<int, int> >("avl", makeKeyVector<int>(n, KeyOrder::UNIFORM, 104));
+
+    // roughly 90% of lookups land on 1% of the keys at this skew
+    vector<int> keys = makeKeyVector<int>(n, KeyOrder::UNIFORM, 104);
+    vector<int> lookups = makeZipfianKeyVector<int>(4 * n, n, 1.2, 105);
+    benchSkewedFind<AVLTree<int, int> >("avl", keys, lookups);
+    benchSkewedFind<RedBlackTree<int, int> >("rb", keys, lookups);
+    benchSkewedFind<SplayTree<int, int> >("splay", keys, lookups);
+    benchSkewedFind<ScapegoatTree<int, int> >("sgt", keys, lookups);
+
+    vector<int> counted = makeZipfianKeyVector<int>(2 * n, n, 0.8, 107);
+    benchCounters<BinarySearchTree<int, int> >("bst", counted);
+    benchCounters<AVLTree<int, int> >("avl", counted);
+
+    benchCleanup<AVLTree<int, int> >("avl", keys);
+    benchCleanup<RedBlackTree<int, int> >("rb", keys);
+
+    benchMemory<BinarySearchTree<int, int>, Node<int, int> >("bst", keys);
+    benchMemory<AVLTree<int, int>, AVLNode<int, int> >("avl", keys);
+
+    benchWideFind<AVLTree<int, WideValue> >("avl", keys);
+    benchWideFind<RedBlackTree<int, WideValue> >("rb", keys);
+
+    vector<string> urls;
+    if(argc > 2)
+    {
+        if(!readUrls(argv[2], urls))
+        {
+            cerr << "Cannot read URLs from " << argv[2] << endl;
+            return 1;
+        }
+    }
+    else
+    {
+        urls = makeUrlKeyVector(n, 108);
+    }
+    benchUrls<string>("avl", "find", urls);
+    benchUrls<PlainString>("avl", "find-cmp", urls);
+
+    benchIntervals(keys);
+
+    benchLatency<AVLTree>("avl", keys);
+    benchLatency<RedBlackTree>("rb", keys);
+
+    return 0;
+}
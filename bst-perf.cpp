@@ -0,0 +1,310 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <vector>
+#include <map>
+#include <string>
+#include <cstring>
+#include <cstdlib>
+#include "bst.h"
+#include "avlbst.h"
+#include "bench_utils.h"
+#include "perf_counters.h"
+
+using namespace std;
+
+// Performance regression check for the tree hot paths.
+// Usage: ./bst-perf [--baseline file] [--update] [--threshold pct] [--time-threshold pct] [numKeys]
+//
+// Measures, per operation, the instructions, cycles, cache misses and branch
+// misses (when hardware counters can be opened) and the wall time of:
+//   find     - lookups of every key (internalFind)
+//   iterate  - a full in-order walk (iterator::operator++)
+//   insert   - building the tree from uniform keys (insertFix rebalancing)
+//   remove   - removing every key (removeFix rebalancing)
+// for BinarySearchTree and AVLTree. Each measurement is the best of RUNS runs.
+// The same four are measured for an AVLTree of random uint64_t keys ("u64"),
+// which searches with the branchless loop for arithmetic keys, and for the
+// same keys wrapped in a class ("u64_generic"), which takes the generic
+// compare-and-branch loop; comparing the two shows what the branchless
+// loop saves in branch misses and time.
+//
+// With --update the results are written to the baseline file (default
+// perf-baseline.txt). Otherwise they are compared with it, and the exit
+// status is 1 if any metric got worse than the baseline by more than the
+// threshold: 10% for the counters, which are stable between runs, and 25%
+// for wall time. Counts come only from runs in which the kernel kept the
+// counters on the whole time (see perf_counters.h). Metrics missing from
+// either side are not compared, so a baseline recorded without counter
+// permissions still checks the times.
+// A missing or unreadable baseline file also exits with 1, after printing
+// the measurements, so that the check cannot pass without one.
+
+static const int RUNS = 5;
+
+// regressions smaller than this in absolute terms (per operation) are noise
+static const double MIN_COUNT_DELTA = 0.05;
+static const double MIN_NS_DELTA = 1.0;
+
+static volatile long benchSink;
+
+typedef map<string, double> Metrics;
+
+// Records the best of the given samples, per operation, under name. The
+// counters come only from samples they were counted for in full; if there
+// is none, the counter metrics are left out (and so not compared).
+static void addMetrics(Metrics& metrics, string const & name, vector<PerfSample> const & samples, size_t ops, bool withCounters)
+{
+    double bestNs = -1;
+    for(size_t i = 0; i < samples.size(); ++i)
+    {
+        double ns = (double)samples[i].ns / ops;
+        if(bestNs < 0 || ns < bestNs)
+        {
+            bestNs = ns;
+        }
+    }
+    metrics[name + ".ns_per_op"] = bestNs;
+
+    if(!withCounters)
+    {
+        return;
+    }
+    size_t counted = 0;
+    for(size_t i = 0; i < samples.size(); ++i)
+    {
+        counted += samples[i].counted ? 1 : 0;
+    }
+    if(counted == 0)
+    {
+        cout << "# " << name << ": the counters were multiplexed in every run; counter metrics left out" << endl;
+        return;
+    }
+    for(int event = 0; event < (int)PerfEvent::NUM_EVENTS; ++event)
+    {
+        double best = -1;
+        for(size_t i = 0; i < samples.size(); ++i)
+        {
+            if(!samples[i].counted)
+            {
+                continue;
+            }
+            double value = (double)samples[i].counts[event] / ops;
+            if(best < 0 || value < best)
+            {
+                best = value;
+            }
+        }
+        metrics[name + "." + perfEventName((PerfEvent)event) + "_per_op"] = best;
+    }
+}
+
+// uint64_t keys that are not arithmetic to the trees, so they search with
+// the generic loop
+struct OpaqueKey
+{
+    OpaqueKey(uint64_t v = 0) : value(v)
+    {
+    }
+
+    bool operator<(OpaqueKey const & other) const { return value < other.value; }
+    bool operator>(OpaqueKey const & other) const { return value > other.value; }
+    bool operator==(OpaqueKey const & other) const { return value == other.value; }
+
+    uint64_t value;
+};
+
+// print() is compiled for every tree, so keys must be printable
+ostream& operator<<(ostream& out, OpaqueKey const & key)
+{
+    return out << key.value;
+}
+
+template<typename Tree, typename KeyType>
+void measureTree(const char* engine, vector<KeyType> const & keys, vector<KeyType> const & lookups, PerfCounters& counters, Metrics& metrics)
+{
+    vector<PerfSample> insertSamples, findSamples, iterateSamples, removeSamples;
+
+    for(int run = 0; run < RUNS; ++run)
+    {
+        Tree tree;
+        counters.start();
+        for(size_t i = 0; i < keys.size(); ++i)
+        {
+            tree.insert(std::make_pair(keys[i], (int)i));
+        }
+        insertSamples.push_back(counters.stop());
+
+        long sum = 0;
+        counters.start();
+        for(size_t i = 0; i < lookups.size(); ++i)
+        {
+            sum += tree.find(lookups[i])->second;
+        }
+        findSamples.push_back(counters.stop());
+
+        counters.start();
+        for(typename Tree::iterator it = tree.begin(); it != tree.end(); ++it)
+        {
+            sum += it->second;
+        }
+        iterateSamples.push_back(counters.stop());
+        benchSink = sum;
+
+        counters.start();
+        for(size_t i = 0; i < lookups.size(); ++i)
+        {
+            tree.remove(lookups[i]);
+        }
+        removeSamples.push_back(counters.stop());
+    }
+
+    string prefix(engine);
+    addMetrics(metrics, prefix + ".insert", insertSamples, keys.size(), counters.available());
+    addMetrics(metrics, prefix + ".find", findSamples, keys.size(), counters.available());
+    addMetrics(metrics, prefix + ".iterate", iterateSamples, keys.size(), counters.available());
+    addMetrics(metrics, prefix + ".remove", removeSamples, keys.size(), counters.available());
+}
+
+static bool readMetrics(const char* filename, Metrics& metrics)
+{
+    ifstream in(filename);
+    if(!in)
+    {
+        return false;
+    }
+    string line;
+    while(getline(in, line))
+    {
+        if(line.empty() || line[0] == '#')
+        {
+            continue;
+        }
+        istringstream fields(line);
+        string name;
+        double value;
+        if(fields >> name >> value)
+        {
+            metrics[name] = value;
+        }
+    }
+    return true;
+}
+
+static void writeMetrics(ostream& out, Metrics const & metrics)
+{
+    out << fixed << setprecision(3);
+    for(Metrics::const_iterator it = metrics.begin(); it != metrics.end(); ++it)
+    {
+        out << it->first << ' ' << it->second << '\n';
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    const char* baselineFile = "perf-baseline.txt";
+    bool update = false;
+    double threshold = 10.0;
+    double timeThreshold = 25.0;
+    size_t n = 200000;
+
+    for(int i = 1; i < argc; ++i)
+    {
+        if(strcmp(argv[i], "--baseline") == 0 && i + 1 < argc)
+        {
+            baselineFile = argv[++i];
+        }
+        else if(strcmp(argv[i], "--update") == 0)
+        {
+            update = true;
+        }
+        else if(strcmp(argv[i], "--threshold") == 0 && i + 1 < argc)
+        {
+            threshold = atof(argv[++i]);
+        }
+        else if(strcmp(argv[i], "--time-threshold") == 0 && i + 1 < argc)
+        {
+            timeThreshold = atof(argv[++i]);
+        }
+        else
+        {
+            n = strtoul(argv[i], NULL, 10);
+        }
+    }
+
+    PerfCounters counters;
+    if(!counters.available())
+    {
+        cout << "# hardware counters unavailable (check /proc/sys/kernel/perf_event_paranoid); timing only" << endl;
+    }
+
+    Metrics current;
+    vector<int> keys = makeKeyVector<int>(n, KeyOrder::UNIFORM, 350);
+    vector<int> lookups = makeKeyVector<int>(n, KeyOrder::UNIFORM, 351);
+    measureTree<BinarySearchTree<int, int> >("bst", keys, lookups, counters, current);
+    measureTree<AVLTree<int, int> >("avl", keys, lookups, counters, current);
+
+    // random 64-bit keys (n distinct draws, in practice), looked up in another random order
+    mt19937_64 randEngine(352);
+    vector<uint64_t> wideKeys(n);
+    for(size_t i = 0; i < n; ++i)
+    {
+        wideKeys[i] = randEngine();
+    }
+    vector<uint64_t> wideLookups(wideKeys);
+    shuffle(wideLookups.begin(), wideLookups.end(), randEngine);
+    measureTree<AVLTree<uint64_t, int> >("avl_u64", wideKeys, wideLookups, counters, current);
+    vector<OpaqueKey> opaqueKeys(wideKeys.begin(), wideKeys.end());
+    vector<OpaqueKey> opaqueLookups(wideLookups.begin(), wideLookups.end());
+    measureTree<AVLTree<OpaqueKey, int> >("avl_u64_generic", opaqueKeys, opaqueLookups, counters, current);
+
+    if(update)
+    {
+        ofstream out(baselineFile);
+        out << "# bst-perf baseline, " << n << " keys\n";
+        writeMetrics(out, current);
+        cout << "Wrote " << current.size() << " metrics to " << baselineFile << endl;
+        return out ? 0 : 1;
+    }
+
+    Metrics baseline;
+    if(!readMetrics(baselineFile, baseline))
+    {
+        // a missing baseline must not pass the check silently
+        writeMetrics(cout, current);
+        cerr << "No baseline in " << baselineFile << "; record one with --update (make perf-baseline)" << endl;
+        return 1;
+    }
+
+    int regressions = 0;
+    cout << fixed << setprecision(3);
+    for(Metrics::const_iterator it = current.begin(); it != current.end(); ++it)
+    {
+        Metrics::const_iterator base = baseline.find(it->first);
+        if(base == baseline.end())
+        {
+            continue;
+        }
+        bool isTime = it->first.find(".ns_per_op") != string::npos;
+        double limit = isTime ? timeThreshold : threshold;
+        double minDelta = isTime ? MIN_NS_DELTA : MIN_COUNT_DELTA;
+        double change = (base->second == 0) ? 0 : 100.0 * (it->second - base->second) / base->second;
+        bool regressed = change > limit && it->second - base->second > minDelta;
+
+        cout << (regressed ? "REGRESSED " : "ok        ") << left << setw(32) << it->first << right
+             << setw(14) << base->second << " -> " << setw(14) << it->second
+             << "  (" << showpos << setprecision(1) << change << noshowpos << setprecision(3) << "%)" << endl;
+        if(regressed)
+        {
+            ++regressions;
+        }
+    }
+
+    if(regressions > 0)
+    {
+        cout << regressions << " metric(s) regressed beyond the threshold" << endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,240 @@
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <vector>
+#include <map>
+#include <deque>
+#include <random>
+#include <string>
+#include <cstring>
+#include <cstdlib>
+#include "bst.h"
+#include "avlbst.h"
+#include "rbbst.h"
+#include "splaybst.h"
+#include "scapegoatbst.h"
+#include "bench_utils.h"
+#include "latency_histogram.h"
+#include "op_trace.h"
+
+using namespace std;
+
+// Records and replays operation traces (see op_trace.h).
+// Usage:
+//   ./bst-replay record trace.bin [numOps]
+//       Runs a synthetic session-cache workload on a TracedTree and saves
+//       its trace; real applications capture theirs the same way.
+//   ./bst-replay trace.bin [engine...]
+//       Replays the trace against each engine (default: bst avl map) and
+//       prints the total time, ns/op and the per-operation p50/p99.
+//       The checksum of every found value must agree between engines.
+
+static const char* DEFAULT_ENGINES[] = {"bst", "avl", "map"};
+
+// Adapters so std::map and the trees can be driven by the same code
+template<typename Tree>
+bool replayFind(Tree& tree, int64_t key, int64_t& value)
+{
+    typename Tree::iterator it = tree.find(key);
+    if(it == tree.end())
+    {
+        return false;
+    }
+    value = it->second;
+    return true;
+}
+
+template<typename Tree>
+void replayInsert(Tree& tree, int64_t key, int64_t value)
+{
+    tree.insert(std::make_pair(key, value));
+}
+
+void replayInsert(map<int64_t, int64_t>& tree, int64_t key, int64_t value)
+{
+    tree[key] = value;
+}
+
+template<typename Tree>
+void replayRemove(Tree& tree, int64_t key)
+{
+    tree.remove(key);
+}
+
+void replayRemove(map<int64_t, int64_t>& tree, int64_t key)
+{
+    tree.erase(key);
+}
+
+template<typename Tree>
+void replay(const char* engine, vector<TraceRecord> const & records)
+{
+    Tree tree;
+    LatencyHistogram histograms[(int)TreeOp::NUM_OPS];
+    uint64_t checksum = 0;
+
+    BenchClock clock;
+    for(size_t i = 0; i < records.size(); ++i)
+    {
+        TraceRecord const & record = records[i];
+        uint64_t start = LatencyClock::now();
+        switch(record.op)
+        {
+            case TraceOp::FIND:
+            {
+                int64_t value;
+                if(replayFind(tree, record.key, value))
+                {
+                    checksum = checksum * 31 + (uint64_t)value;
+                }
+                histograms[(int)TreeOp::FIND].record(LatencyClock::now() - start);
+                break;
+            }
+            case TraceOp::INSERT:
+                replayInsert(tree, record.key, record.value);
+                histograms[(int)TreeOp::INSERT].record(LatencyClock::now() - start);
+                break;
+            case TraceOp::REMOVE:
+                replayRemove(tree, record.key);
+                histograms[(int)TreeOp::REMOVE].record(LatencyClock::now() - start);
+                break;
+            case TraceOp::CLEAR:
+                tree.clear();
+                break;
+        }
+    }
+    uint64_t ns = clock.elapsedNs();
+
+    cout << left << setw(8) << engine << right << setw(12) << records.size() << " ops"
+         << setw(10) << ns / 1000000 << " ms" << setw(10) << fixed << setprecision(1)
+         << (records.empty() ? 0.0 : (double)ns / records.size()) << " ns/op"
+         << "  checksum " << hex << checksum << dec << endl;
+    string prefix = string("  ") + engine;
+    printLatencyHistograms(cout, prefix.c_str(), histograms);
+}
+
+// A session cache: random ids are created, looked up mostly while they are
+// recent, and expire in arrival order once more than window are live.
+static int recordSynthetic(const char* filename, size_t numOps)
+{
+    ofstream out(filename, ios::binary);
+    if(!out)
+    {
+        cerr << "Cannot write " << filename << endl;
+        return 1;
+    }
+    TraceWriter writer(out);
+    TracedTree<AVLTree, int64_t, int64_t> tree;
+    tree.setTrace(&writer);
+
+    mt19937 randEngine(360);
+    const size_t window = 50000;
+    deque<int64_t> live;
+    for(size_t i = 0; i < numOps; ++i)
+    {
+        unsigned roll = randEngine() % 10;
+        if(roll < 3 || live.empty())
+        {
+            int64_t id = randEngine();
+            live.push_back(id);
+            tree.insert(std::make_pair(id, (int64_t)i));
+        }
+        else if(roll < 4)
+        {
+            if(live.size() > window)
+            {
+                tree.remove(live.front());
+                live.pop_front();
+            }
+            else
+            {
+                // a session that ends early; its id may still be looked up
+                tree.remove(live[randEngine() % live.size()]);
+            }
+        }
+        else
+        {
+            // recent ids are looked up far more often than old ones
+            size_t age = randEngine() % live.size();
+            age = (size_t)((uint64_t)age * age / live.size());
+            tree.find(live[live.size() - 1 - age]);
+        }
+    }
+    tree.setTrace(NULL);
+    out.close();
+
+    cout << "Recorded " << writer.count() << " ops to " << filename << endl;
+    return out ? 0 : 1;
+}
+
+int main(int argc, char *argv[])
+{
+    if(argc < 2)
+    {
+        cerr << "Usage: " << argv[0] << " record trace.bin [numOps]" << endl;
+        cerr << "       " << argv[0] << " trace.bin [engine...]" << endl;
+        return 1;
+    }
+    if(strcmp(argv[1], "record") == 0)
+    {
+        if(argc < 3)
+        {
+            cerr << "Missing trace file" << endl;
+            return 1;
+        }
+        return recordSynthetic(argv[2], argc > 3 ? strtoul(argv[3], NULL, 10) : 1000000);
+    }
+
+    ifstream in(argv[1], ios::binary);
+    vector<TraceRecord> records;
+    if(!in || !readTrace(in, records))
+    {
+        cerr << "Cannot read trace " << argv[1] << endl;
+        return 1;
+    }
+
+    vector<string> engines;
+    for(int i = 2; i < argc; ++i)
+    {
+        engines.push_back(argv[i]);
+    }
+    if(engines.empty())
+    {
+        engines.assign(DEFAULT_ENGINES, DEFAULT_ENGINES + sizeof(DEFAULT_ENGINES) / sizeof(DEFAULT_ENGINES[0]));
+    }
+
+    for(size_t i = 0; i < engines.size(); ++i)
+    {
+        string const & engine = engines[i];
+        if(engine == "bst")
+        {
+            replay<BinarySearchTree<int64_t, int64_t> >("bst", records);
+        }
+        else if(engine == "avl")
+        {
+            replay<AVLTree<int64_t, int64_t> >("avl", records);
+        }
+        else if(engine == "rb")
+        {
+            replay<RedBlackTree<int64_t, int64_t> >("rb", records);
+        }
+        else if(engine == "splay")
+        {
+            replay<SplayTree<int64_t, int64_t> >("splay", records);
+        }
+        else if(engine == "sgt")
+        {
+            replay<ScapegoatTree<int64_t, int64_t> >("sgt", records);
+        }
+        else if(engine == "map")
+        {
+            replay<map<int64_t, int64_t> >("map", records);
+        }
+        else
+        {
+            cerr << "Unknown engine " << engine << endl;
+            return 1;
+        }
+    }
+    return 0;
+}
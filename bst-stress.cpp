@@ -0,0 +1,125 @@
+#include <iostream>
+#include <cstdlib>
+#include "bst.h"
+#include "avlbst.h"
+#include "bench_utils.h"
+
+using namespace std;
+
+// Stress test for the traversals on degenerate trees: a plain BinarySearchTree
+// fed sorted keys is a linked list, so anything that recurses once per level
+// would overflow the call stack long before numNodes (default 10M) is reached.
+// Usage: ./bst-stress [numNodes]
+
+static int failures = 0;
+
+static void check(bool ok, const char* what, uint64_t ns)
+{
+    cout << (ok ? "PASS " : "FAIL ") << what << " (" << ns / 1000000 << " ms)" << endl;
+    if(!ok)
+    {
+        ++failures;
+    }
+}
+
+// Gives the stress test a way to grow a left spine in O(1) per node; a normal
+// insert of decreasing keys would walk the whole spine every time.
+class SpineTree : public BinarySearchTree<int, int>
+{
+public:
+    SpineTree():
+    smallest_(nullptr)
+    {
+    }
+
+    void prependSmallest(int key)
+    {
+        smallest_ = insertAt(smallest_, true, std::make_pair(key, key));
+    }
+
+private:
+    Node<int, int>* smallest_;
+};
+
+int main(int argc, char *argv[])
+{
+    int n = 10000000;
+    if(argc > 1)
+    {
+        n = atoi(argv[1]);
+    }
+    cout << "Degenerate trees with " << n << " nodes" << endl;
+
+    {
+        BenchClock clock;
+        BinarySearchTree<int, int> rightSpine;
+        for(int i = 0; i < n; ++i)
+        {
+            rightSpine.insert(std::make_pair(i, i));
+        }
+        check(true, "build right spine with increasing inserts", clock.elapsedNs());
+
+        clock.restart();
+        bool ok = !rightSpine.isBalanced() || n < 3;
+        check(ok, "right spine isBalanced", clock.elapsedNs());
+
+        clock.restart();
+        int count = 0;
+        for(BinarySearchTree<int, int>::iterator it = rightSpine.begin(); it != rightSpine.end(); ++it)
+        {
+            ++count;
+        }
+        check(count == n, "right spine iteration", clock.elapsedNs());
+
+        clock.restart();
+        rightSpine.remove(n - 1);
+        rightSpine.remove(0);
+        uint64_t ns = clock.elapsedNs(); // the checking finds walk the spine too, so stop first
+        ok = rightSpine.find(n - 1) == rightSpine.end() && rightSpine.find(n / 2) != rightSpine.end();
+        check(ok, "right spine remove", ns);
+
+        clock.restart();
+        rightSpine.clear();
+        check(rightSpine.empty(), "right spine clear", clock.elapsedNs());
+    }
+
+    {
+        BenchClock clock;
+        SpineTree leftSpine;
+        for(int i = n; i > 0; --i)
+        {
+            leftSpine.prependSmallest(i);
+        }
+        check(true, "build left spine", clock.elapsedNs());
+
+        clock.restart();
+        bool ok = !leftSpine.isBalanced() || n < 3;
+        check(ok, "left spine isBalanced", clock.elapsedNs());
+    }
+
+    {
+        BenchClock clock;
+        AVLTree<int, int> avl;
+        for(int i = 0; i < n; ++i)
+        {
+            avl.insert(std::make_pair(i, i));
+        }
+        check(true, "AVL sorted inserts", clock.elapsedNs());
+
+        clock.restart();
+        bool ok = avl.isBalanced();
+        check(ok, "AVL isBalanced", clock.elapsedNs());
+
+        // removing every other key keeps removeFix climbing long paths
+        clock.restart();
+        for(int i = 0; i < n; i += 2)
+        {
+            avl.remove(i);
+        }
+        uint64_t ns = clock.elapsedNs();
+        ok = avl.isBalanced() && avl.find(1) != avl.end() && avl.find(2) == avl.end();
+        check(ok, "AVL remove half", ns);
+    }
+
+    return failures == 0 ? 0 : 1;
+}
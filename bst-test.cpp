@@ -1,7 +1,17 @@
 #include <iostream>
+#include <sstream>
 #include <map>
+#include <vector>
+#include <string>
+#include <stdexcept>
 #include "bst.h"
 #include "avlbst.h"
+#include "rbbst.h"
+#include "splaybst.h"
+#include "scapegoatbst.h"
+#include "intervalbst.h"
+#include "latency_histogram.h"
+#include "tree_export.h"
 
 using namespace std;
 
@@ -26,6 +36,26 @@ int main(int argc, char *argv[])
     cout << "Erasing b" << endl;
     bt.remove('b');
 
+    // keys arriving in order can be appended with an end() hint
+    BinarySearchTree<int,int> seq;
+    for(int i = 0; i < 5; ++i) {
+        seq.insert(seq.end(), std::make_pair(i, i * i));
+    }
+    seq.insert(seq.find(3), std::make_pair(-1, 1)); // wrong hint still inserts
+    cout << "Appended:";
+    for(BinarySearchTree<int,int>::iterator it = seq.begin(); it != seq.end(); ++it) {
+        cout << " " << it->first;
+    }
+    cout << endl;
+
+    // batched lookups
+    std::vector<int> wanted = {4, 7, -1};
+    std::vector<BinarySearchTree<int,int>::iterator> results;
+    seq.findMany(wanted, results);
+    for(size_t i = 0; i < wanted.size(); ++i) {
+        cout << wanted[i] << (results[i] == seq.end() ? " missing" : " found") << endl;
+    }
+
     // AVL Tree Tests
     AVLTree<char,int> at;
     at.insert(std::make_pair('a',1));
@@ -44,5 +74,177 @@ int main(int argc, char *argv[])
     cout << "Erasing b" << endl;
     at.remove('b');
 
+    // Red-Black Tree Tests
+    RedBlackTree<char,int> rt;
+    rt.insert(std::make_pair('a',1));
+    rt.insert(std::make_pair('b',2));
+    rt.insert(std::make_pair('c',3));
+
+    cout << "\nRedBlackTree contents:" << endl;
+    for(RedBlackTree<char,int>::iterator it = rt.begin(); it != rt.end(); ++it) {
+        cout << it->first << " " << it->second << endl;
+    }
+    if(rt.isBalanced()) {
+        cout << "Balanced" << endl;
+    }
+    cout << "Erasing b" << endl;
+    rt.remove('b');
+    if(rt.find('b') == rt.end()) {
+        cout << "Did not find b" << endl;
+    }
+
+    // Splay Tree Tests
+    SplayTree<char,int> st;
+    st.insert(std::make_pair('a',1));
+    st.insert(std::make_pair('b',2));
+    st.insert(std::make_pair('c',3));
+
+    cout << "\nSplayTree contents:" << endl;
+    for(SplayTree<char,int>::iterator it = st.begin(); it != st.end(); ++it) {
+        cout << it->first << " " << it->second << endl;
+    }
+    if(st.find('a') != st.end()) {
+        cout << "Found a" << endl;
+    }
+    cout << "Erasing b" << endl;
+    st.remove('b');
+    if(st.find('b') == st.end()) {
+        cout << "Did not find b" << endl;
+    }
+
+    // Scapegoat Tree Tests
+    ScapegoatTree<char,int> sg;
+    for(char c = 'a'; c <= 'g'; ++c) {
+        sg.insert(std::make_pair(c, c - 'a' + 1));
+    }
+
+    cout << "\nScapegoatTree contents:" << endl;
+    for(ScapegoatTree<char,int>::iterator it = sg.begin(); it != sg.end(); ++it) {
+        cout << it->first << " " << it->second << endl;
+    }
+    cout << "Erasing b" << endl;
+    sg.remove('b');
+    if(sg.find('b') == sg.end()) {
+        cout << "Did not find b" << endl;
+    }
+
+    // Operation counters (all zero unless built with make DEFS=-DBST_STATS)
+    AVLTree<int,int> counted;
+    for(int i = 0; i < 7; ++i) {
+        counted.insert(std::make_pair((i * 5) % 7, i));
+    }
+    counted.find(3);
+    counted.remove(4);
+    TreeStats ts = counted.stats();
+    cout << "\nAVLTree counters:" << endl;
+    cout << "comparisons " << ts.comparisons << ", nodes visited " << ts.nodesVisited
+         << ", rotations " << ts.rotations << ", restructures " << ts.restructures
+         << ", removeFixes " << ts.removeFixes << ", allocations " << ts.allocations
+         << ", frees " << ts.frees << endl;
+
+    // Latency histograms (timings vary, so only the sample counts are printed)
+    LatencyTrackedTree<BinarySearchTree, int, int> timed;
+    timed.insert(std::make_pair(2, 2));
+    timed.insert(std::make_pair(1, 1));
+    timed.insert(std::make_pair(3, 3));
+    timed.find(1);
+    timed.remove(2);
+    cout << "\nTimed " << timed.latency(TreeOp::INSERT).count() << " inserts, "
+         << timed.latency(TreeOp::FIND).count() << " find, "
+         << timed.latency(TreeOp::REMOVE).count() << " remove" << endl;
+
+    // Printing draws only the top levels, so it is cheap on large trees too
+    cout << "\nAVLTree print:" << endl;
+    counted.print(cout);
+    AVLTree<int,int> large;
+    for(int i = 0; i < 100000; ++i) {
+        large.insert(std::make_pair(i, i));
+    }
+    ostringstream drawing;
+    large.print(drawing);
+    cout << "Printed a " << 100000 << "-key tree in " << drawing.str().size() << " bytes" << endl;
+
+    // Scan-and-delete with erase(iterator), then a range erase
+    AVLTree<int,int> expiring;
+    for(int i = 0; i < 20; ++i) {
+        expiring.insert(std::make_pair(i, i % 3));
+    }
+    for(AVLTree<int,int>::iterator it = expiring.begin(); it != expiring.end(); ) {
+        it = (it->second == 0) ? expiring.erase(it) : ++it;
+    }
+    expiring.erase(expiring.find(5), expiring.find(17));
+    cout << "\nAfter erasing:";
+    for(AVLTree<int,int>::iterator it = expiring.begin(); it != expiring.end(); ++it) {
+        cout << " " << it->first;
+    }
+    cout << (expiring.isBalanced() ? " (balanced)" : " (unbalanced)") << endl;
+
+    RedBlackTree<int,int> swept;
+    for(int i = 0; i < 20; ++i) {
+        swept.insert(std::make_pair(i, i));
+    }
+    size_t sweptCount = swept.eraseIf([](std::pair<const int, int> const & item) { return item.first % 3 != 0; });
+    cout << "eraseIf removed " << sweptCount << ", left:";
+    for(RedBlackTree<int,int>::iterator it = swept.begin(); it != swept.end(); ++it) {
+        cout << " " << it->first;
+    }
+    cout << endl;
+
+    // Single-descent updates; operator[] still throws for missing keys
+    BinarySearchTree<string,int> counters;
+    counters.upsert("x", 0, [](int& count) { ++count; });
+    counters.upsert("x", 0, [](int& count) { ++count; });
+    counters.getOrInsert("y") += 5;
+    counters.modify("y", [](int& count) { count *= 2; });
+    bool assigned = counters.insertOrAssign("z", 1).second;
+    cout << "\nCounters: x=" << counters["x"] << " y=" << counters["y"]
+         << " z=" << counters["z"] << (assigned ? " (z inserted)" : "") << endl;
+    try {
+        counters["w"];
+    } catch(std::out_of_range const &) {
+        cout << "w is missing" << endl;
+    }
+
+    // Moving nodes between trees without copying them
+    AVLTree<int,int> archive;
+    for(int i = 1; i < 20; i += 3) {
+        AVLTree<int,int>::node_type moved = expiring.extract(i);
+        if(moved) {
+            archive.insert(std::move(moved));
+        }
+    }
+    cout << "\nArchived:";
+    for(AVLTree<int,int>::iterator it = archive.begin(); it != archive.end(); ++it) {
+        cout << " " << it->first;
+    }
+    cout << ((expiring.isBalanced() && archive.isBalanced()) ? " (both balanced)" : " (unbalanced)") << endl;
+
+    // Time ranges: which overlap a window, and which contain an instant
+    IntervalTree<int,string> meetings;
+    meetings.insert(std::make_pair(Interval<int>(9, 10), string("standup")));
+    meetings.insert(std::make_pair(Interval<int>(9, 17), string("on call")));
+    meetings.insert(std::make_pair(Interval<int>(11, 12), string("review")));
+    meetings.insert(std::make_pair(Interval<int>(13, 15), string("planning")));
+    meetings.insert(std::make_pair(Interval<int>(16, 16), string("demo")));
+    meetings.remove(Interval<int>(16, 16));
+    std::vector<IntervalTree<int,string>::iterator> busy;
+    meetings.findOverlapping(12, 13, busy);
+    cout << "\nOverlapping [12, 13]:";
+    for(size_t i = 0; i < busy.size(); ++i) {
+        cout << " " << busy[i]->first << " " << busy[i]->second << ";";
+    }
+    meetings.findContaining(10, busy);
+    cout << "\nContaining 10:";
+    for(size_t i = 0; i < busy.size(); ++i) {
+        cout << " " << busy[i]->second << ";";
+    }
+    cout << endl;
+
+    // Structure export of the subtree at 5, below depth 1
+    ExportOptions json(ExportFormat::JSON);
+    json.maxDepth = 2;
+    cout << "\nAVLTree subtree export:" << endl;
+    exportSubtree(counted, 5, cout, json);
+
     return 0;
 }
@@ -4,8 +4,303 @@
 #include <iostream>
 #include <exception>
 #include <cstdlib>
+#include <cstdint>
 #include <utility>
+#include <new>
+#include <type_traits>
+#include <algorithm>
 #include <queue>
+#include <vector>
+#include <string>
+#include <cstring>
+#include <cstddef>
+
+// Number of independent searches findMany keeps in flight at once.
+#define BST_FIND_MANY_LANES 16
+
+// erase(first, last) rebuilds the whole tree instead of erasing the range
+// node by node once at most this many keys survive per erased key.
+#define BST_ERASE_REBUILD_RATIO 4
+
+// Hint the CPU to start loading a node we are about to visit.
+#if defined(__GNUC__)
+#define BST_PREFETCH(ptr) __builtin_prefetch(ptr)
+#else
+#define BST_PREFETCH(ptr)
+#endif
+
+// Node layout. Build with -DAVL_TAGGED_BALANCE (e.g. make
+// DEFS=-DAVL_TAGGED_BALANCE) to keep the AVL balance in the low bits of the
+// parent pointer instead of a separate member, so that an AVLNode is no
+// bigger than a Node. Nodes are at least 8-byte aligned, so those bits are
+// always zero in a real address.
+
+// Key/value separation. Build with -DBST_COLD_VALUE_BYTES=N (e.g. make
+// DEFS=-DBST_COLD_VALUE_BYTES=64) to keep values larger than N bytes out of
+// the nodes: a node then holds a copy of its key next to the links, and the
+// (key, value) pair lives in a store owned by the tree that only a hit reads.
+// Searches touch only the small nodes, which the allocator can pack densely
+// since the pairs come from elsewhere. Trees with smaller values keep the
+// pair inside the node.
+#ifdef BST_COLD_VALUE_BYTES
+#define BST_COLD_VALUE(Value) (sizeof(Value) > (BST_COLD_VALUE_BYTES))
+#else
+#define BST_COLD_VALUE(Value) false
+#endif
+
+// Operation counters. Build with -DBST_STATS (e.g. make DEFS=-DBST_STATS) to
+// have every tree count its work; otherwise BST_COUNT compiles to nothing and
+// the trees carry no extra members. BST_COUNT may only be used inside
+// non-static member functions of a tree.
+#ifdef BST_STATS
+#define BST_COUNT(counter, n) (this -> stats_.counter += (n))
+#else
+#define BST_COUNT(counter, n) ((void)0)
+#endif
+
+/**
+* A snapshot of the operation counters of one tree (see BST_STATS).
+* All fields stay zero when the counters are compiled out.
+*/
+struct TreeStats
+{
+    TreeStats() :
+        comparisons(0), nodesVisited(0), rotations(0), restructures(0),
+        removeFixes(0), allocations(0), frees(0)
+    {
+    }
+
+    unsigned long long comparisons;  // key comparisons while searching in find/insert/remove
+    unsigned long long nodesVisited; // nodes stepped through by those searches
+    unsigned long long rotations;    // single rotations (a double rotation counts 2)
+    unsigned long long restructures; // insert rebalances and subtree rebuilds
+    unsigned long long removeFixes;  // rebalance passes started by a remove
+    unsigned long long allocations;  // nodes created
+    unsigned long long frees;        // nodes deleted
+};
+
+/**
+* The store for the cold items of one tree: slots for Item carved out of
+* large blocks, so they are never interleaved with the nodes. Slots are
+* handed out in address order within a block, so items made one after
+* another sit next to each other. A block is freed as soon as its last item
+* is released (one empty block is kept to avoid thrashing at a block
+* boundary). Like the tree that owns it, a store takes no lock. An item made
+* without a store gets a slot of its own, which is how a node travels in a
+* NodeHandle.
+*/
+template <typename Item>
+class ColdItemStore
+{
+public:
+    ColdItemStore() : open_(nullptr), spare_(nullptr)
+    {
+    }
+
+    // A copy starts empty; items belong to the store that made them
+    ColdItemStore(const ColdItemStore&) : open_(nullptr), spare_(nullptr)
+    {
+    }
+
+    // Every item has been released by now, so only the spare is left
+    ~ColdItemStore()
+    {
+        ::operator delete(spare_);
+    }
+
+    // A slot from store, or one of its own if store is NULL
+    static void* allocate(ColdItemStore* store)
+    {
+        if (store == nullptr){
+            Slot* slot = new Slot;
+            slot -> block = nullptr;
+            return &slot -> payload;
+        }
+        return store -> allocateInBlock();
+    }
+
+    // Returns the slot to the store that made it
+    static void release(void* item)
+    {
+        Slot* slot = reinterpret_cast<Slot*>(static_cast<char*>(item) - offsetof(Slot, payload));
+        if (slot -> block == nullptr){
+            delete slot;
+            return;
+        }
+        slot -> block -> store -> releaseInBlock(slot);
+    }
+
+private:
+    static const size_t SLOTS_PER_BLOCK = 1024;
+
+    struct Block;
+
+    struct Slot
+    {
+        Block* block; // NULL for a slot of its own
+        union Payload
+        {
+            Slot* next;
+            typename std::aligned_storage<sizeof(Item), alignof(Item)>::type item;
+        } payload;
+    };
+
+    struct Block
+    {
+        ColdItemStore* store;
+        Block* prev;  // neighbours in the list of blocks with free slots
+        Block* next;
+        Slot* freeSlots; // released slots; slots past carved were never used
+        size_t used;
+        size_t carved;
+        Slot slots[SLOTS_PER_BLOCK];
+    };
+
+    ColdItemStore& operator=(const ColdItemStore&);
+
+    void* allocateInBlock()
+    {
+        if (open_ == nullptr){
+            Block* block = spare_;
+            spare_ = nullptr;
+            if (block == nullptr){
+                block = static_cast<Block*>(::operator new(sizeof(Block)));
+                block -> store = this;
+                block -> used = 0;
+                block -> carved = 0;
+                block -> freeSlots = nullptr;
+            }
+            link(block);
+        }
+        Block* block = open_;
+        Slot* slot = block -> freeSlots;
+        if (slot != nullptr){
+            block -> freeSlots = slot -> payload.next;
+        } else {
+            slot = &block -> slots[block -> carved++];
+            slot -> block = block;
+        }
+        if (++block -> used == SLOTS_PER_BLOCK){
+            unlink(block); //full: nothing more to hand out here
+        }
+        return &slot -> payload;
+    }
+
+    void releaseInBlock(Slot* slot)
+    {
+        Block* block = slot -> block;
+        if (block -> used == SLOTS_PER_BLOCK){
+            link(block);
+        }
+        slot -> payload.next = block -> freeSlots;
+        block -> freeSlots = slot;
+        if (--block -> used == 0){
+            unlink(block);
+            block -> carved = 0;
+            block -> freeSlots = nullptr;
+            ::operator delete(spare_);
+            spare_ = block;
+        }
+    }
+
+    void link(Block* block)
+    {
+        block -> prev = nullptr;
+        block -> next = open_;
+        if (open_ != nullptr){
+            open_ -> prev = block;
+        }
+        open_ = block;
+    }
+
+    void unlink(Block* block)
+    {
+        if (block -> prev != nullptr){
+            block -> prev -> next = block -> next;
+        } else {
+            open_ = block -> next;
+        }
+        if (block -> next != nullptr){
+            block -> next -> prev = block -> prev;
+        }
+    }
+
+    Block* open_;  // blocks with a slot to hand out
+    Block* spare_; // an empty block kept for reuse
+};
+
+/**
+* Where a node keeps its item: inside the node (as the pair itself), or
+* (Cold) behind a pointer with the key copied into the node, in a slot of
+* the tree's store (see BST_COLD_VALUE_BYTES).
+*/
+template <typename Key, typename Value, bool Cold>
+class NodeItem : public std::pair<const Key, Value>
+{
+public:
+    class Store { }; //the pair is in the node, so there is nothing to store
+
+    NodeItem(const Key& key, const Value& value, Store*) : std::pair<const Key, Value>(key, value) { }
+
+    void moveTo(Store*) { }
+    const Key& key() const { return this -> first; }
+    std::pair<const Key, Value>& item() { return *this; }
+    const std::pair<const Key, Value>& item() const { return *this; }
+};
+
+template <typename Key, typename Value>
+class NodeItem<Key, Value, true>
+{
+public:
+    typedef ColdItemStore<std::pair<const Key, Value> > Store;
+
+    NodeItem(const Key& key, const Value& value, Store* store) : key_(key), item_(newItem(store, key, value)) { }
+    ~NodeItem()
+    {
+        item_ -> ~Item();
+        Store::release(item_);
+    }
+
+    // Moves the pair into store (into a slot of its own if store is NULL)
+    void moveTo(Store* store)
+    {
+        void* slot = Store::allocate(store);
+        Item* moved;
+        try {
+            moved = new (slot) Item(std::move(*item_));
+        } catch (...) {
+            Store::release(slot);
+            throw;
+        }
+        item_ -> ~Item();
+        Store::release(item_);
+        item_ = moved;
+    }
+
+    const Key& key() const { return key_; }
+    std::pair<const Key, Value>& item() { return *item_; }
+    const std::pair<const Key, Value>& item() const { return *item_; }
+
+private:
+    typedef std::pair<const Key, Value> Item;
+
+    NodeItem(const NodeItem& other);
+    NodeItem& operator=(const NodeItem& other);
+
+    static Item* newItem(Store* store, const Key& key, const Value& value)
+    {
+        void* slot = Store::allocate(store);
+        try {
+            return new (slot) Item(key, value);
+        } catch (...) {
+            Store::release(slot);
+            throw;
+        }
+    }
+
+    const Key key_;
+    Item* item_;
+};
 
 /**
  * A templated class for a Node in a search tree.
@@ -18,7 +313,10 @@ template <typename Key, typename Value>
 class Node
 {
 public:
-    Node(const Key& key, const Value& value, Node<Key, Value>* parent);
+    // Where the trees keep cold items (an empty type unless BST_COLD_VALUE_BYTES applies)
+    typedef typename NodeItem<Key, Value, BST_COLD_VALUE(Value)>::Store ItemStore;
+
+    Node(const Key& key, const Value& value, Node<Key, Value>* parent, ItemStore* store = nullptr);
     virtual ~Node();
 
     const std::pair<const Key, Value>& getItem() const;
@@ -30,17 +328,27 @@ public:
     virtual Node<Key, Value>* getParent() const;
     virtual Node<Key, Value>* getLeft() const;
     virtual Node<Key, Value>* getRight() const;
+    // The left (0) or right (1) child, picked without a branch
+    Node<Key, Value>* getChild(int right) const;
 
     void setParent(Node<Key, Value>* parent);
     void setLeft(Node<Key, Value>* left);
     void setRight(Node<Key, Value>* right);
     void setValue(const Value &value);
+    void moveItemTo(ItemStore* store);
 
 protected:
-    std::pair<const Key, Value> item_;
+#ifdef AVL_TAGGED_BALANCE
+    // The low bits of parent_ hold a tag for subclasses (always 0 in a plain
+    // Node); getParent and setParent leave it alone
+    static const uintptr_t PARENT_TAG_MASK = 7;
+    unsigned getParentTag() const;
+    void setParentTag(unsigned tag);
+#endif
+
+    NodeItem<Key, Value, BST_COLD_VALUE(Value)> item_;
     Node<Key, Value>* parent_;
-    Node<Key, Value>* left_;
-    Node<Key, Value>* right_;
+    Node<Key, Value>* children_[2]; // left, right
 };
 
 /*
@@ -53,12 +361,12 @@ protected:
 * Explicit constructor for a node.
 */
 template<typename Key, typename Value>
-Node<Key, Value>::Node(const Key& key, const Value& value, Node<Key, Value>* parent) :
-    item_(key, value),
-    parent_(parent),
-    left_(NULL),
-    right_(NULL)
+Node<Key, Value>::Node(const Key& key, const Value& value, Node<Key, Value>* parent, ItemStore* store) :
+    item_(key, value, store),
+    parent_(parent)
 {
+    children_[0] = NULL;
+    children_[1] = NULL;
 
 }
 
@@ -79,7 +387,7 @@ Node<Key, Value>::~Node()
 template<typename Key, typename Value>
 const std::pair<const Key, Value>& Node<Key, Value>::getItem() const
 {
-    return item_;
+    return item_.item();
 }
 
 /**
@@ -88,7 +396,7 @@ const std::pair<const Key, Value>& Node<Key, Value>::getItem() const
 template<typename Key, typename Value>
 std::pair<const Key, Value>& Node<Key, Value>::getItem()
 {
-    return item_;
+    return item_.item();
 }
 
 /**
@@ -97,7 +405,7 @@ std::pair<const Key, Value>& Node<Key, Value>::getItem()
 template<typename Key, typename Value>
 const Key& Node<Key, Value>::getKey() const
 {
-    return item_.first;
+    return item_.key();
 }
 
 /**
@@ -106,7 +414,7 @@ const Key& Node<Key, Value>::getKey() const
 template<typename Key, typename Value>
 const Value& Node<Key, Value>::getValue() const
 {
-    return item_.second;
+    return item_.item().second;
 }
 
 /**
@@ -115,7 +423,7 @@ const Value& Node<Key, Value>::getValue() const
 template<typename Key, typename Value>
 Value& Node<Key, Value>::getValue()
 {
-    return item_.second;
+    return item_.item().second;
 }
 
 /**
@@ -124,7 +432,11 @@ Value& Node<Key, Value>::getValue()
 template<typename Key, typename Value>
 Node<Key, Value>* Node<Key, Value>::getParent() const
 {
+#ifdef AVL_TAGGED_BALANCE
+    return reinterpret_cast<Node<Key, Value>*>(reinterpret_cast<uintptr_t>(parent_) & ~PARENT_TAG_MASK);
+#else
     return parent_;
+#endif
 }
 
 /**
@@ -133,7 +445,7 @@ Node<Key, Value>* Node<Key, Value>::getParent() const
 template<typename Key, typename Value>
 Node<Key, Value>* Node<Key, Value>::getLeft() const
 {
-    return left_;
+    return children_[0];
 }
 
 /**
@@ -142,7 +454,16 @@ Node<Key, Value>* Node<Key, Value>::getLeft() const
 template<typename Key, typename Value>
 Node<Key, Value>* Node<Key, Value>::getRight() const
 {
-    return right_;
+    return children_[1];
+}
+
+/**
+* A non-virtual getter for either child, for the search loops.
+*/
+template<typename Key, typename Value>
+Node<Key, Value>* Node<Key, Value>::getChild(int right) const
+{
+    return children_[right];
 }
 
 /**
@@ -151,7 +472,11 @@ Node<Key, Value>* Node<Key, Value>::getRight() const
 template<typename Key, typename Value>
 void Node<Key, Value>::setParent(Node<Key, Value>* parent)
 {
+#ifdef AVL_TAGGED_BALANCE
+    parent_ = reinterpret_cast<Node<Key, Value>*>(reinterpret_cast<uintptr_t>(parent) | getParentTag());
+#else
     parent_ = parent;
+#endif
 }
 
 /**
@@ -160,7 +485,7 @@ void Node<Key, Value>::setParent(Node<Key, Value>* parent)
 template<typename Key, typename Value>
 void Node<Key, Value>::setLeft(Node<Key, Value>* left)
 {
-    left_ = left;
+    children_[0] = left;
 }
 
 /**
@@ -169,7 +494,7 @@ void Node<Key, Value>::setLeft(Node<Key, Value>* left)
 template<typename Key, typename Value>
 void Node<Key, Value>::setRight(Node<Key, Value>* right)
 {
-    right_ = right;
+    children_[1] = right;
 }
 
 /**
@@ -178,15 +503,158 @@ void Node<Key, Value>::setRight(Node<Key, Value>* right)
 template<typename Key, typename Value>
 void Node<Key, Value>::setValue(const Value& value)
 {
-    item_.second = value;
+    item_.item().second = value;
+}
+
+/**
+* Moves a cold item into store, or into a slot of its own if store is NULL.
+* Does nothing when the item is kept in the node.
+*/
+template<typename Key, typename Value>
+void Node<Key, Value>::moveItemTo(ItemStore* store)
+{
+    item_.moveTo(store);
+}
+
+#ifdef AVL_TAGGED_BALANCE
+/**
+* The tag kept in the low bits of the parent pointer.
+*/
+template<typename Key, typename Value>
+unsigned Node<Key, Value>::getParentTag() const
+{
+    return (unsigned)(reinterpret_cast<uintptr_t>(parent_) & PARENT_TAG_MASK);
 }
 
+template<typename Key, typename Value>
+void Node<Key, Value>::setParentTag(unsigned tag)
+{
+    uintptr_t parent = reinterpret_cast<uintptr_t>(parent_) & ~PARENT_TAG_MASK;
+    parent_ = reinterpret_cast<Node<Key, Value>*>(parent | (tag & PARENT_TAG_MASK));
+}
+#endif
+
 /*
   ---------------------------------------
   End implementations for the Node class.
   ---------------------------------------
 */
 
+/**
+* Owns a node taken out of a tree with extract(). Insert it into another tree
+* of the same type to move the item without allocating or copying it; a
+* handle that is destroyed while still holding its node deletes it. A cold
+* item (see BST_COLD_VALUE_BYTES) is moved into a slot of its own by
+* extract, so references to it taken before extract do not carry over.
+*/
+template <typename Key, typename Value>
+class NodeHandle
+{
+public:
+    NodeHandle();
+    NodeHandle(NodeHandle&& other);
+    NodeHandle& operator=(NodeHandle&& other);
+    ~NodeHandle();
+
+    bool empty() const;
+    explicit operator bool() const;
+    const Key& key() const;
+    Value& value() const;
+
+private:
+    template<typename TKey, typename TValue>
+    friend class BinarySearchTree;
+    NodeHandle(Node<Key, Value>* node);
+    NodeHandle(const NodeHandle& other);
+    NodeHandle& operator=(const NodeHandle& other);
+
+    Node<Key, Value>* node_;
+};
+
+template<typename Key, typename Value>
+NodeHandle<Key, Value>::NodeHandle() : node_(nullptr)
+{
+
+}
+
+template<typename Key, typename Value>
+NodeHandle<Key, Value>::NodeHandle(Node<Key, Value>* node) : node_(node)
+{
+
+}
+
+template<typename Key, typename Value>
+NodeHandle<Key, Value>::NodeHandle(NodeHandle&& other) : node_(other.node_)
+{
+    other.node_ = nullptr;
+}
+
+template<typename Key, typename Value>
+NodeHandle<Key, Value>& NodeHandle<Key, Value>::operator=(NodeHandle&& other)
+{
+    if (this != &other){
+        delete node_;
+        node_ = other.node_;
+        other.node_ = nullptr;
+    }
+    return *this;
+}
+
+template<typename Key, typename Value>
+NodeHandle<Key, Value>::~NodeHandle()
+{
+    delete node_;
+}
+
+template<typename Key, typename Value>
+bool NodeHandle<Key, Value>::empty() const
+{
+    return node_ == nullptr;
+}
+
+template<typename Key, typename Value>
+NodeHandle<Key, Value>::operator bool() const
+{
+    return node_ != nullptr;
+}
+
+/**
+* The key and value of the held node. The handle must not be empty.
+*/
+template<typename Key, typename Value>
+const Key& NodeHandle<Key, Value>::key() const
+{
+    return node_ -> getKey();
+}
+
+template<typename Key, typename Value>
+Value& NodeHandle<Key, Value>::value() const
+{
+    return node_ -> getValue();
+}
+
+/**
+* Which search loop a key type gets (see BinarySearchTree::descend):
+* arithmetic keys a branchless one, strings one that skips the prefix the
+* key is already known to share with the node, anything else the plain
+* compare-and-branch loop.
+*/
+struct GenericKeySearch { };
+struct ArithmeticKeySearch { };
+struct StringKeySearch { };
+
+template<typename Key>
+struct KeySearch
+{
+    typedef typename std::conditional<std::is_arithmetic<Key>::value, ArithmeticKeySearch, GenericKeySearch>::type type;
+};
+
+template<typename CharT, typename Traits, typename Alloc>
+struct KeySearch<std::basic_string<CharT, Traits, Alloc> >
+{
+    typedef StringKeySearch type;
+};
+
 /**
 * A templated unbalanced binary search tree.
 */
@@ -200,11 +668,13 @@ public:
     virtual void remove(const Key& key); //TODO
     void clear(); //TODO
     bool isBalanced() const; //TODO
-    void print() const;
+    void print(std::ostream& out = std::cout) const;
     bool empty() const;
 
     template<typename PPKey, typename PPValue>
     friend void prettyPrintBST(BinarySearchTree<PPKey, PPValue> & tree);
+    template<typename EKey, typename EValue>
+    friend class TreeExporter;
 public:
     /**
     * An internal iterator class for traversing the contents of the BST.
@@ -232,9 +702,33 @@ public:
     iterator begin() const;
     iterator end() const;
     iterator find(const Key& key) const;
+    void findMany(const std::vector<Key>& keys, std::vector<iterator>& out) const;
+    iterator insert(iterator hint, const std::pair<const Key, Value>& keyValuePair);
+    iterator erase(iterator pos);
+    iterator erase(iterator first, iterator last);
+    template<typename Predicate>
+    size_t eraseIf(Predicate pred);
     Value& operator[](const Key& key);
     Value const & operator[](const Key& key) const;
 
+    // Read-modify-write in a single descent
+    std::pair<iterator, bool> insertOrAssign(const Key& key, const Value& value);
+    Value& getOrInsert(const Key& key);
+    template<typename Modifier>
+    bool modify(const Key& key, Modifier fn);
+    template<typename Modifier>
+    std::pair<iterator, bool> upsert(const Key& key, const Value& initial, Modifier fn);
+
+    // Moving nodes between trees of the same type. extract returns an empty
+    // handle if there is nothing to take. insert leaves the node in the handle
+    // and returns the existing item if the key is already present.
+    typedef NodeHandle<Key, Value> node_type;
+    node_type extract(const Key& key);
+    node_type extract(iterator pos);
+    std::pair<iterator, bool> insert(node_type&& handle);
+    TreeStats stats() const;
+    void resetStats();
+
 protected:
     // Mandatory helper functions
     Node<Key, Value>* internalFind(const Key& k) const; // TODO
@@ -244,16 +738,71 @@ protected:
     //        and instead just use the input argument.
 
     // Provided helper functions
-    virtual void printRoot (Node<Key, Value> *r) const;
+    virtual void printRoot (Node<Key, Value> *r, std::ostream& out = std::cout) const;
     virtual void nodeSwap( Node<Key,Value>* n1, Node<Key,Value>* n2) ;
 
     // Add helper functions here
     static int helperHeight(Node<Key, Value>* node, bool& isBalanced);
+    void removeNode(Node<Key, Value>* node);
+
+    // Removal of a node that was already found: remove(key), erase() and
+    // extract() all end in unlinkNode, where subclasses restore their
+    // invariants. Nodes are relinked, never copied, so iterators to other
+    // nodes stay valid. eraseNode also deletes the node.
+    void eraseNode(Node<Key, Value>* node);
+    virtual void unlinkNode(Node<Key, Value>* node);
+    // Called after erase(first, last) relinked the survivors into a balanced
+    // tree of the given height with linkBalanced
+    virtual void rebuiltTree(size_t removed, int height);
+    // Called at the end of clear(), once the tree is empty. The destructor
+    // clears too, but by then only this base version runs.
+    virtual void cleared();
+    void relinkAll(std::vector<Node<Key, Value>*>& nodes, size_t removed);
+
+    // Linking new nodes. Every insert goes through attachNode and every
+    // remove through retreatRightmost so that rightmost_ stays exact.
+    virtual Node<Key, Value>* insertAt(Node<Key, Value>* parent, bool isLeft, const std::pair<const Key, Value>& keyValuePair);
+    Node<Key, Value>* findOrInsert(const Key& key, const Value& value, bool& inserted);
+    Node<Key, Value>* findSlot(const Key& key, Node<Key, Value>*& parent, bool& isLeft) const;
+    // The search loop behind internalFind and findSlot, picked by KeySearch.
+    // Arithmetic keys take a branchless step: the comparison result indexes
+    // the child array, so the only branch per level (key found) is almost
+    // never taken. String keys skip the characters already known to match.
+    // Other keys keep the two-way compare and need only < and >.
+    Node<Key, Value>* descend(const Key& key, Node<Key, Value>*& parent, bool& isLeft) const;
+    Node<Key, Value>* descend(const Key& key, Node<Key, Value>*& parent, bool& isLeft, ArithmeticKeySearch) const;
+    Node<Key, Value>* descend(const Key& key, Node<Key, Value>*& parent, bool& isLeft, StringKeySearch) const;
+    Node<Key, Value>* descend(const Key& key, Node<Key, Value>*& parent, bool& isLeft, GenericKeySearch) const;
+    virtual void linkNode(Node<Key, Value>* parent, bool isLeft, Node<Key, Value>* node);
+    void attachNode(Node<Key, Value>* parent, bool isLeft, Node<Key, Value>* node);
+    void retreatRightmost(Node<Key, Value>* node);
+
+    // Linear-time rebuild of a subtree into a perfectly balanced shape,
+    // reusing its nodes (see rebuildSubtree below)
+    static void flattenSubtree(Node<Key, Value>* node, std::vector<Node<Key, Value>*>& nodes);
+    Node<Key, Value>* rebuildSubtree(Node<Key, Value>* node);
+    Node<Key, Value>* linkBalanced(std::vector<Node<Key, Value>*>& nodes, size_t lo, size_t hi, Node<Key, Value>* parent, int& height);
+    virtual void rebuiltNode(Node<Key, Value>* node, int leftHeight, int rightHeight);
+    // For subclass queries that find nodes without going through find()
+    static iterator iteratorAt(Node<Key, Value>* node);
+    // Where insertAt's new nodes keep their cold items
+    typename Node<Key, Value>::ItemStore* itemStore();
 
 
 protected:
     Node<Key, Value>* root_;
-    // You should not need other data members
+    // The node with the largest key (NULL iff the tree is empty), so that
+    // appends in increasing key order skip the root-to-leaf search
+    Node<Key, Value>* rightmost_;
+#ifdef BST_STATS
+    // mutable so that const lookups can count too
+    mutable TreeStats stats_;
+#endif
+#ifdef BST_COLD_VALUE_BYTES
+    // Cold items of the nodes this tree made; a node from a NodeHandle keeps
+    // the slot of its own that extract gave it
+    typename Node<Key, Value>::ItemStore coldItems_;
+#endif
 };
 
 /*
@@ -402,6 +951,10 @@ BinarySearchTree<Key, Value>::iterator::operator++()
         }
     }
 
+    //no right subtree and no parent: current_ was the last node
+    current_ = nullptr;
+    return *this;
+
 
 
 
@@ -441,6 +994,7 @@ BinarySearchTree<Key, Value>::BinarySearchTree()
     // TODO
 
     root_ = nullptr;
+    rightmost_ = nullptr;
 
 }
 
@@ -461,10 +1015,10 @@ bool BinarySearchTree<Key, Value>::empty() const
 }
 
 template<typename Key, typename Value>
-void BinarySearchTree<Key, Value>::print() const
+void BinarySearchTree<Key, Value>::print(std::ostream& out) const
 {
-    printRoot(root_);
-    std::cout << "\n";
+    printRoot(root_, out);
+    out << "\n";
 }
 
 /**
@@ -502,6 +1056,63 @@ BinarySearchTree<Key, Value>::find(const Key & k) const
     return it;
 }
 
+/**
+* Looks up every key in keys and stores an iterator to each one (or end())
+* in the matching slot of out. Up to BST_FIND_MANY_LANES searches advance in
+* lockstep, one level per round, and each prefetches the child it will visit
+* next, so the cache misses of independent searches overlap instead of being
+* paid one after another as in a loop over find().
+*/
+template<class Key, class Value>
+void BinarySearchTree<Key, Value>::findMany(const std::vector<Key>& keys, std::vector<iterator>& out) const
+{
+    out.assign(keys.size(), end());
+
+    Node<Key, Value>* lanes[BST_FIND_MANY_LANES];
+    size_t laneKey[BST_FIND_MANY_LANES];
+
+    for (size_t first = 0; first < keys.size(); first += BST_FIND_MANY_LANES){
+        size_t numLanes = std::min((size_t)BST_FIND_MANY_LANES, keys.size() - first);
+        for (size_t lane = 0; lane < numLanes; ++lane){
+            lanes[lane] = root_;
+            laneKey[lane] = first + lane;
+        }
+
+        //each round moves every live search down one level; finished lanes
+        //are swapped out of the live range
+        size_t live = (root_ == nullptr) ? 0 : numLanes;
+        while (live > 0){
+            for (size_t lane = 0; lane < live; ){
+                Node<Key, Value>* cn = lanes[lane];
+                const Key& key = keys[laneKey[lane]];
+                Node<Key, Value>* next;
+                BST_COUNT(nodesVisited, 1);
+                if (key < cn->getKey()){
+                    BST_COUNT(comparisons, 1);
+                    next = cn->getLeft();
+                } else if (cn->getKey() < key){
+                    BST_COUNT(comparisons, 2);
+                    next = cn->getRight();
+                } else {
+                    BST_COUNT(comparisons, 2);
+                    out[laneKey[lane]] = iterator(cn);
+                    next = nullptr;
+                }
+
+                if (next == nullptr){
+                    --live;
+                    lanes[lane] = lanes[live];
+                    laneKey[lane] = laneKey[live];
+                } else {
+                    BST_PREFETCH(next);
+                    lanes[lane] = next;
+                    ++lane;
+                }
+            }
+        }
+    }
+}
+
 /**
  * @precondition The key exists in the map
  * Returns the value associated with the key
@@ -521,6 +1132,89 @@ Value const & BinarySearchTree<Key, Value>::operator[](const Key& key) const
     return curr->getValue();
 }
 
+/**
+* Sets the value of key, inserting it if it is missing. Returns an iterator to
+* the element and whether it was inserted.
+*/
+template<class Key, class Value>
+std::pair<typename BinarySearchTree<Key, Value>::iterator, bool>
+BinarySearchTree<Key, Value>::insertOrAssign(const Key& key, const Value& value)
+{
+    bool inserted;
+    Node<Key, Value>* node = findOrInsert(key, value, inserted);
+    if (!inserted){
+        node -> setValue(value);
+    }
+    return std::make_pair(iterator(node), inserted);
+}
+
+/**
+* Like operator[], but a missing key is inserted with a default-constructed
+* value instead of throwing.
+*/
+template<class Key, class Value>
+Value& BinarySearchTree<Key, Value>::getOrInsert(const Key& key)
+{
+    bool inserted;
+    return findOrInsert(key, Value(), inserted) -> getValue();
+}
+
+/**
+* Calls fn(value) on the value of key, in place. Returns false, calling
+* nothing, if key is not in the tree.
+*/
+template<class Key, class Value>
+template<typename Modifier>
+bool BinarySearchTree<Key, Value>::modify(const Key& key, Modifier fn)
+{
+    Node<Key, Value>* node = internalFind(key);
+    if (node == nullptr){
+        return false;
+    }
+    fn(node -> getValue());
+    return true;
+}
+
+/**
+* Calls fn(value) on the value of key, first inserting key with the value
+* initial if it is missing (so upsert(k, 0, increment) leaves a new counter at
+* 1). Returns an iterator to the element and whether it was inserted.
+*/
+template<class Key, class Value>
+template<typename Modifier>
+std::pair<typename BinarySearchTree<Key, Value>::iterator, bool>
+BinarySearchTree<Key, Value>::upsert(const Key& key, const Value& initial, Modifier fn)
+{
+    bool inserted;
+    Node<Key, Value>* node = findOrInsert(key, initial, inserted);
+    fn(node -> getValue());
+    return std::make_pair(iterator(node), inserted);
+}
+
+/**
+* Returns a copy of the operation counters (all zero unless built with BST_STATS).
+*/
+template<class Key, class Value>
+TreeStats BinarySearchTree<Key, Value>::stats() const
+{
+#ifdef BST_STATS
+    return stats_;
+#else
+    return TreeStats();
+#endif
+}
+
+/**
+* Zeroes the operation counters.
+*/
+template<class Key, class Value>
+void BinarySearchTree<Key, Value>::resetStats()
+{
+#ifdef BST_STATS
+    stats_ = TreeStats();
+#endif
+}
+
 /**
 * An insert method to insert into a Binary Search Tree.
 * The tree will not remain balanced when inserting.
@@ -532,45 +1226,354 @@ void BinarySearchTree<Key, Value>::insert(const std::pair<const Key, Value> &key
 {
     // TODO
 
-   if (root_ == nullptr){
-        Node<Key, Value>* newNode = new Node<Key, Value>(keyValuePair.first, keyValuePair.second, nullptr);
-        root_ = newNode;
+   //findSlot takes keys arriving in increasing order straight to the maximum
+   Node<Key, Value>* parent_node;
+   bool isLeft;
+   Node<Key, Value>* current_node = findSlot(keyValuePair.first, parent_node, isLeft);
+   if (current_node != nullptr){
+        //need to replace this item;
+        current_node->setValue(keyValuePair.second);
         return;
    }
+   insertAt(parent_node, isLeft, keyValuePair);
+}
 
-   //now, must traverse list.
-
-   Node<Key, Value>* current_node = root_;
-   Node<Key, Value>* parent_node;
-   bool isLeft = false;
-   while (current_node != nullptr){
-
-            parent_node = current_node;
-        if (keyValuePair.first == current_node->getKey()){
-            //need to replace this item;
-           
-            current_node->setValue(keyValuePair.second);
-            return;
-        } 
+/**
+* Inserts using hint, an iterator to the element the new key should go right
+* before (end() means "after the current maximum"), as in std::map. When the
+* hint is right the node is linked into the gap next to it without searching
+* from the root. That costs O(1) for end() (appends) and otherwise the distance
+* from the hint to its in-order predecessor, which is O(1) amortized when the
+* hints walk forward through the tree. A wrong hint falls back to one search
+* from the root, which inserts or updates the key where it ends. Returns an
+* iterator to the inserted or updated element.
+*/
+template<class Key, class Value>
+typename BinarySearchTree<Key, Value>::iterator
+BinarySearchTree<Key, Value>::insert(iterator hint, const std::pair<const Key, Value>& keyValuePair)
+{
+    Node<Key, Value>* next = hint.current_;
+    Node<Key, Value>* prev = (next == nullptr) ? rightmost_ : predecessor(next);
 
-        if (keyValuePair.first < current_node->getKey()){
-            current_node = current_node ->getLeft();
-            isLeft = true;
+    //an equal key on either side of the gap is just an update
+    if (next != nullptr && keyValuePair.first == next->getKey()){
+        next->setValue(keyValuePair.second);
+        return hint;
+    }
+    if (prev != nullptr && keyValuePair.first == prev->getKey()){
+        prev->setValue(keyValuePair.second);
+        return iterator(prev);
+    }
+
+    bool fits = (next == nullptr || keyValuePair.first < next->getKey()) &&
+                (prev == nullptr || prev->getKey() < keyValuePair.first);
+    if (!fits){
+        return insertOrAssign(keyValuePair.first, keyValuePair.second).first;
+    }
+
+    if (next != nullptr && next->getLeft() == nullptr){
+        return iterator(insertAt(next, true, keyValuePair));
+    }
+    //prev is the maximum, the rightmost node of next's left subtree, or NULL
+    //for an empty tree; in each case its right slot is the free one
+    return iterator(insertAt(prev, false, keyValuePair));
+}
+
+/**
+* Returns the node holding key, or links a new one holding (key, value) where
+* the search ended. inserted tells which. insertAt does any rebalancing, and
+* since rebalancing relinks nodes rather than moving items, the returned node
+* still holds key afterwards.
+*/
+template<class Key, class Value>
+Node<Key, Value>* BinarySearchTree<Key, Value>::findOrInsert(const Key& key, const Value& value, bool& inserted)
+{
+    Node<Key, Value>* parent;
+    bool isLeft;
+    Node<Key, Value>* cn = findSlot(key, parent, isLeft);
+    inserted = (cn == nullptr);
+    if (cn != nullptr){
+        return cn;
+    }
+    return insertAt(parent, isLeft, std::make_pair(key, value));
+}
+
+/**
+* One descent for key: returns its node, or NULL with parent and isLeft set to
+* the empty slot where it belongs. Keys past the largest one go straight to
+* the right of rightmost_.
+*/
+template<class Key, class Value>
+Node<Key, Value>* BinarySearchTree<Key, Value>::findSlot(const Key& key, Node<Key, Value>*& parent, bool& isLeft) const
+{
+    if (root_ != nullptr){
+        BST_COUNT(comparisons, 1);
+        if (rightmost_ -> getKey() < key){
+            parent = rightmost_;
+            isLeft = false;
+            return nullptr;
+        }
+    }
+    return descend(key, parent, isLeft);
+}
+
+/**
+* Searches from the root for key: returns its node, or NULL with parent and
+* isLeft set to the empty slot where it belongs (parent is NULL if the tree
+* is empty). The loop is chosen at compile time from the key type.
+*/
+template<class Key, class Value>
+Node<Key, Value>* BinarySearchTree<Key, Value>::descend(const Key& key, Node<Key, Value>*& parent, bool& isLeft) const
+{
+    return descend(key, parent, isLeft, typename KeySearch<Key>::type());
+}
+
+/**
+* Branchless descent for arithmetic keys.
+*/
+template<class Key, class Value>
+Node<Key, Value>* BinarySearchTree<Key, Value>::descend(const Key& key, Node<Key, Value>*& parent, bool& isLeft, ArithmeticKeySearch) const
+{
+    Node<Key, Value>* cn = root_;
+    int right = 1;
+    parent = nullptr;
+    while (cn != nullptr){
+        BST_COUNT(nodesVisited, 1);
+        BST_COUNT(comparisons, 2);
+        const Key nodeKey = cn -> getKey();
+        if (nodeKey == key){
+            return cn;
+        }
+        right = (nodeKey < key);
+        parent = cn;
+        cn = cn -> getChild(right);
+    }
+    isLeft = !right;
+    return nullptr;
+}
+
+/**
+* The length of the common prefix of a and b (at most n), given that the
+* first `from` characters are known to match. Plain char strings are compared
+* eight bytes at a time.
+*/
+template<typename Traits, typename CharT>
+size_t matchingPrefix(const CharT* a, const CharT* b, size_t from, size_t n)
+{
+    size_t i = from;
+    while (i < n && Traits::eq(a[i], b[i])){
+        ++i;
+    }
+    return i;
+}
+
+#if defined(__GNUC__) && defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+template<>
+inline size_t matchingPrefix<std::char_traits<char>, char>(const char* a, const char* b, size_t from, size_t n)
+{
+    size_t i = from;
+    for (; i + 8 <= n; i += 8){
+        uint64_t wordA, wordB;
+        memcpy(&wordA, a + i, 8);
+        memcpy(&wordB, b + i, 8);
+        if (wordA != wordB){
+            return i + __builtin_ctzll(wordA ^ wordB) / 8; //first differing byte
+        }
+    }
+    while (i < n && a[i] == b[i]){
+        ++i;
+    }
+    return i;
+}
+#endif
+
+/**
+* Descent for string keys that does not re-scan shared prefixes. Every node
+* below a right turn at L and a left turn at H lies between L and H, as does
+* key, so it shares at least min(lcp(key, L), lcp(key, H)) leading characters
+* with key; the comparison starts after them. For keys with long common
+* prefixes (URLs, paths) that is most of each comparison. Unlike the
+* arithmetic loop this one branches on the direction: a predicted branch lets
+* the CPU start loading the next node and its string while the comparison is
+* still running, which a child index computed from the result would not.
+*/
+template<class Key, class Value>
+Node<Key, Value>* BinarySearchTree<Key, Value>::descend(const Key& key, Node<Key, Value>*& parent, bool& isLeft, StringKeySearch) const
+{
+    typedef typename Key::traits_type Traits;
+    Node<Key, Value>* cn = root_;
+    size_t lowMatch = 0;  //characters key shares with the last node it went right of
+    size_t highMatch = 0; //and with the last node it went left of
+    parent = nullptr;
+    isLeft = false;
+    while (cn != nullptr){
+        BST_COUNT(nodesVisited, 1);
+        BST_COUNT(comparisons, 1);
+        const Key& nodeKey = cn -> getKey();
+        size_t common = std::min(nodeKey.size(), key.size());
+        size_t i = matchingPrefix<Traits>(nodeKey.data(), key.data(), std::min(lowMatch, highMatch), common);
+        bool right;
+        if (i < common){
+            right = Traits::lt(nodeKey[i], key[i]);
+        } else if (nodeKey.size() != key.size()){
+            right = (nodeKey.size() < key.size()); //a proper prefix sorts first
+        } else {
+            return cn;
+        }
+        parent = cn;
+        isLeft = !right;
+        if (right){
+            lowMatch = i;
+            cn = cn -> getRight();
         } else {
-            current_node = current_node ->getRight();
-            // parent_node = current_node->getParent();
+            highMatch = i;
+            cn = cn -> getLeft();
+        }
+    }
+    return nullptr;
+}
+
+/**
+* Two-way compare descent for all other keys.
+*/
+template<class Key, class Value>
+Node<Key, Value>* BinarySearchTree<Key, Value>::descend(const Key& key, Node<Key, Value>*& parent, bool& isLeft, GenericKeySearch) const
+{
+    Node<Key, Value>* cn = root_;
+    parent = nullptr;
+    isLeft = false;
+    while (cn != nullptr){
+        BST_COUNT(nodesVisited, 1);
+        if (key > cn -> getKey()){
+            BST_COUNT(comparisons, 1);
+            parent = cn;
+            cn = cn -> getRight();
             isLeft = false;
+        } else if (key < cn -> getKey()){
+            BST_COUNT(comparisons, 2);
+            parent = cn;
+            cn = cn -> getLeft();
+            isLeft = true;
+        } else {
+            BST_COUNT(comparisons, 2);
+            return cn;
         }
+    }
+    return nullptr;
+}
 
-   }
-   Node<Key, Value>* newNode = new Node<Key, Value>(keyValuePair.first, keyValuePair.second, parent_node);
-   if (isLeft){
-        parent_node->setLeft(newNode);
-   } else {
-        parent_node-> setRight(newNode);
-   }
-   return;
+/**
+* Takes the node holding key out of the tree, with the same rebalancing as
+* remove(key), and hands it over instead of deleting it.
+*/
+template<class Key, class Value>
+NodeHandle<Key, Value> BinarySearchTree<Key, Value>::extract(const Key& key)
+{
+    return extract(find(key));
+}
 
+/**
+* Takes the node at pos out of the tree. Iterators to other nodes stay valid.
+*/
+template<class Key, class Value>
+NodeHandle<Key, Value> BinarySearchTree<Key, Value>::extract(iterator pos)
+{
+    Node<Key, Value>* node = pos.current_;
+    if (node == nullptr){
+        return node_type();
+    }
+    node -> moveItemTo(nullptr); //the handle may outlive this tree's store
+    unlinkNode(node);
+    return node_type(node);
+}
+
+/**
+* Links the node held by handle into this tree, leaving the handle empty.
+* The node keeps its address, key and value; only its links (and balance or
+* colour, which linkNode resets) change. A cold item (BST_COLD_VALUE_BYTES)
+* keeps the slot of its own that extract gave it. The handle must come from a tree of
+* the same type, so that the node is of the type this tree links.
+*/
+template<class Key, class Value>
+std::pair<typename BinarySearchTree<Key, Value>::iterator, bool>
+BinarySearchTree<Key, Value>::insert(node_type&& handle)
+{
+    if (handle.node_ == nullptr){
+        return std::make_pair(end(), false);
+    }
+    Node<Key, Value>* node = handle.node_;
+    Node<Key, Value>* parent;
+    bool isLeft;
+    Node<Key, Value>* cn = findSlot(node -> getKey(), parent, isLeft);
+    if (cn != nullptr){
+        return std::make_pair(iterator(cn), false);
+    }
+    handle.node_ = nullptr;
+    node -> setParent(parent);
+    node -> setLeft(nullptr);
+    node -> setRight(nullptr);
+    linkNode(parent, isLeft, node);
+    return std::make_pair(iterator(node), true);
+}
+
+/**
+* Creates a node for keyValuePair and links it as the given child of parent
+* (or as the root if parent is NULL), then restores any balance invariants.
+* The slot must be empty and the key must belong there.
+* Returns the new node.
+*/
+template<class Key, class Value>
+Node<Key, Value>* BinarySearchTree<Key, Value>::insertAt(Node<Key, Value>* parent, bool isLeft, const std::pair<const Key, Value>& keyValuePair)
+{
+    Node<Key, Value>* newNode = new Node<Key, Value>(keyValuePair.first, keyValuePair.second, parent, itemStore());
+    BST_COUNT(allocations, 1);
+    linkNode(parent, isLeft, newNode);
+    return newNode;
+}
+
+/**
+* Links node (already pointing at parent, with no children) into the given
+* empty slot and restores any balance invariants. insertAt creates the node;
+* insert(handle) brings one from another tree. The plain tree only attaches it.
+*/
+template<class Key, class Value>
+void BinarySearchTree<Key, Value>::linkNode(Node<Key, Value>* parent, bool isLeft, Node<Key, Value>* node)
+{
+    attachNode(parent, isLeft, node);
+}
+
+/**
+* Links node (already pointing at parent) into the empty child slot of parent,
+* or makes it the root if parent is NULL, keeping rightmost_ current.
+*/
+template<class Key, class Value>
+void BinarySearchTree<Key, Value>::attachNode(Node<Key, Value>* parent, bool isLeft, Node<Key, Value>* node)
+{
+    if (parent == nullptr){
+        root_ = node;
+        rightmost_ = node;
+    } else if (isLeft){
+        parent->setLeft(node);
+    } else {
+        parent->setRight(node);
+        if (parent == rightmost_){
+            rightmost_ = node;
+        }
+    }
+}
+
+/**
+* Must be called before node (the node holding the key being removed) is
+* unlinked. If it is the maximum, its in-order predecessor becomes the new one.
+*/
+template<class Key, class Value>
+void BinarySearchTree<Key, Value>::retreatRightmost(Node<Key, Value>* node)
+{
+    if (node == rightmost_){
+        //the maximum has no right child, so the next largest is the top of its
+        //left subtree's right spine, or else its parent
+        rightmost_ = predecessor(node);
+    }
 }
 
 
@@ -583,24 +1586,174 @@ template<typename Key, typename Value>
 void BinarySearchTree<Key, Value>::remove(const Key& key)
 {
     // TODO
-    Node<Key, Value>* curr_node = root_;
-
-    //the following while loop searches the tree, finds the node that matches the key
-    while (curr_node != nullptr){
-        if (key > curr_node -> getKey()){
-            curr_node = curr_node-> getRight();
-        } else if (key < curr_node -> getKey()){
-            curr_node = curr_node -> getLeft();
+    Node<Key, Value>* curr_node = internalFind(key);
+    if (curr_node == nullptr){ //key not found in tree
+        return;
+    }
+
+    eraseNode(curr_node);
+}
+
+/**
+* Removes the element pos points to without searching for its key again, and
+* returns an iterator to the element after it.
+*/
+template<typename Key, typename Value>
+typename BinarySearchTree<Key, Value>::iterator
+BinarySearchTree<Key, Value>::erase(iterator pos)
+{
+    Node<Key, Value>* node = pos.current_;
+    if (node == nullptr){
+        return pos;
+    }
+    ++pos;
+    eraseNode(node);
+    return pos;
+}
+
+/**
+* Removes the elements in [first, last) and returns last. Small ranges are
+* erased node by node; when the range is large next to what survives
+* (see BST_ERASE_REBUILD_RATIO) the survivors are relinked into a balanced
+* tree in one linear pass instead of rebalancing after every deletion.
+*/
+template<typename Key, typename Value>
+typename BinarySearchTree<Key, Value>::iterator
+BinarySearchTree<Key, Value>::erase(iterator first, iterator last)
+{
+    if (first == last){
+        return last;
+    }
+
+    //count the range, then the survivors up to the point where erasing
+    //one by one is cheaper; this costs O(range size), never O(n)
+    size_t removed = 0;
+    for (iterator it = first; it != last; ++it){
+        ++removed;
+    }
+    size_t budget = removed * BST_ERASE_REBUILD_RATIO;
+    size_t survivors = 0;
+    for (iterator it = begin(); it != first && survivors <= budget; ++it){
+        ++survivors;
+    }
+    for (iterator it = last; it != end() && survivors <= budget; ++it){
+        ++survivors;
+    }
+    if (survivors > budget){
+        while (first != last){
+            first = erase(first);
+        }
+        return last;
+    }
+
+    std::vector<Node<Key, Value>*> nodes;
+    flattenSubtree(root_, nodes);
+    size_t lo = 0;
+    while (nodes[lo] != first.current_){
+        ++lo;
+    }
+    for (size_t i = lo; i < lo + removed; ++i){
+        delete nodes[i];
+    }
+    BST_COUNT(frees, removed);
+    nodes.erase(nodes.begin() + lo, nodes.begin() + lo + removed);
+    relinkAll(nodes, removed);
+    return last;
+}
+
+/**
+* Removes every element for which pred(element) is true and returns how many
+* were removed. pred is called once per element, in key order. The survivors
+* are collected while the iterator streams through the tree, and then relinked
+* into a balanced tree in O(n). The surviving nodes are reused, not
+* reallocated. When only a few elements match, they are erased in place
+* instead, like erase(first, last) does for small ranges.
+*/
+template<typename Key, typename Value>
+template<typename Predicate>
+size_t BinarySearchTree<Key, Value>::eraseIf(Predicate pred)
+{
+    std::vector<Node<Key, Value>*> survivors;
+    std::vector<Node<Key, Value>*> doomed;
+    for (iterator it = begin(); it != end(); ++it){
+        if (pred(*it)){
+            doomed.push_back(it.current_);
         } else {
-            break;
+            survivors.push_back(it.current_);
         }
     }
+    if (doomed.empty()){
+        return 0;
+    }
 
-    if (curr_node == nullptr){ //key not found in tree
-        return;
+    //only now, since the iterator climbs through nodes it has already passed.
+    //A few removals are cheaper in place (see BST_ERASE_REBUILD_RATIO).
+    if (survivors.size() > doomed.size() * BST_ERASE_REBUILD_RATIO){
+        for (size_t i = 0; i < doomed.size(); ++i){
+            eraseNode(doomed[i]);
+        }
+        return doomed.size();
     }
+    for (size_t i = 0; i < doomed.size(); ++i){
+        delete doomed[i];
+    }
+    BST_COUNT(frees, doomed.size());
+    relinkAll(survivors, doomed.size());
+    return doomed.size();
+}
 
-    //curr_node now holds the value with the key
+/**
+* Makes nodes (every node left in the tree, in order) a balanced tree with
+* linkBalanced, after removed others were deleted.
+*/
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::relinkAll(std::vector<Node<Key, Value>*>& nodes, size_t removed)
+{
+    BST_COUNT(restructures, 1);
+    int height;
+    root_ = linkBalanced(nodes, 0, nodes.size(), nullptr, height);
+    rightmost_ = nodes.empty() ? nullptr : nodes.back();
+    rebuiltTree(removed, height);
+}
+
+/**
+* Unlinks and deletes a node that is known to be in the tree.
+*/
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::eraseNode(Node<Key, Value>* node)
+{
+    unlinkNode(node);
+    delete node;
+    BST_COUNT(frees, 1);
+}
+
+/**
+* The plain tree has nothing to rebalance.
+*/
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::unlinkNode(Node<Key, Value>* node)
+{
+    removeNode(node);
+}
+
+/**
+* Nothing to update for the plain tree.
+*/
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::rebuiltTree(size_t removed, int height)
+{
+
+}
+
+/**
+* Unlinks a node that is known to be in the tree, leaving it to the caller.
+*/
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::removeNode(Node<Key, Value>* curr_node)
+{
+    retreatRightmost(curr_node);
+
+    //curr_node holds the value with the key
     Node<Key, Value>* swap_node = curr_node;
 
 
@@ -639,7 +1792,6 @@ void BinarySearchTree<Key, Value>::remove(const Key& key)
                 curr_node -> getParent()-> setRight(lchild);
                 lchild-> setParent(curr_node-> getParent());
             }
-            delete curr_node;
             
         } else { //case 2: the predecessor has no children
             if (isLeft){
@@ -648,7 +1800,6 @@ void BinarySearchTree<Key, Value>::remove(const Key& key)
                 curr_node -> getParent()-> setRight(nullptr);
             }
             
-            delete curr_node;
             // return;
         }
 
@@ -670,7 +1821,6 @@ void BinarySearchTree<Key, Value>::remove(const Key& key)
             } else {
                 root_ = nullptr;
             }
-            delete curr_node;
             return;
         }
 
@@ -688,12 +1838,10 @@ void BinarySearchTree<Key, Value>::remove(const Key& key)
             if (isLeft){
                 curr_node -> getParent() -> setLeft(curr_node-> getLeft());
                 curr_node -> getLeft()->setParent(curr_node->getParent());
-                delete curr_node;
                 return;
             } else {
                 curr_node -> getParent()-> setRight(curr_node->getLeft());
                 curr_node-> getLeft()-> setParent(curr_node-> getParent());
-                delete curr_node;
                 return;
             }
 
@@ -703,12 +1851,10 @@ void BinarySearchTree<Key, Value>::remove(const Key& key)
             if (isLeft){
                 curr_node -> getParent() -> setLeft(curr_node-> getRight());   
                 curr_node -> getRight()->setParent(curr_node->getParent());
-                delete curr_node;
                 return;
             } else {
                 curr_node -> getParent()-> setRight(curr_node->getRight());
                 curr_node-> getRight()-> setParent(curr_node-> getParent());
-                delete curr_node;
                 return;
 
             }
@@ -722,7 +1868,6 @@ void BinarySearchTree<Key, Value>::remove(const Key& key)
         } else {
             curr_node-> getParent()-> setRight(nullptr);
         }
-        delete curr_node;
         return;
     }
 
@@ -742,6 +1887,15 @@ BinarySearchTree<Key, Value>::predecessor(Node<Key, Value>* current)
     if (cn == nullptr){
         return nullptr;
     }
+    if (cn -> getLeft() == nullptr){
+        //no left subtree: the predecessor is the first ancestor we reach from its right side
+        Node<Key, Value>* parent = cn -> getParent();
+        while (parent != nullptr && cn == parent -> getLeft()){
+            cn = parent;
+            parent = parent -> getParent();
+        }
+        return parent;
+    }
     cn = cn -> getLeft();
     while (cn -> getRight()!= nullptr){
         cn = cn-> getRight();
@@ -759,11 +1913,10 @@ template<typename Key, typename Value>
 void BinarySearchTree<Key, Value>::clear()
 {
     // TODO
-    if (root_ == nullptr){
-        return;
-    }
     std::queue<Node<Key, Value>*> tree;
-    tree.push(root_);
+    if (root_ != nullptr){
+        tree.push(root_);
+    }
     while (!(tree.empty())){
         Node<Key,Value>* cn = tree.front();
         if (cn -> getLeft() != nullptr){
@@ -774,9 +1927,21 @@ void BinarySearchTree<Key, Value>::clear()
         }
         tree.pop();
         delete cn;
+        BST_COUNT(frees, 1);
         
     }
     root_ = nullptr;
+    rightmost_ = nullptr;
+    cleared();
+
+}
+
+/**
+* Nothing to reset for the plain tree.
+*/
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::cleared()
+{
 
 }
 
@@ -810,24 +1975,9 @@ template<typename Key, typename Value>
 Node<Key, Value>* BinarySearchTree<Key, Value>::internalFind(const Key& key) const
 {
     // TODO
-    Node<Key, Value>* cn = root_;
-    if (root_ == nullptr){
-        return nullptr;
-    }
-
-
-    while (cn != nullptr){
-        if (key > cn-> getKey()){
-            cn = cn-> getRight();
-        } else if (key < cn -> getKey()){
-            cn = cn-> getLeft();
-        } else {
-            return cn;
-        }
-    }
-    return nullptr;
-
-
+    Node<Key, Value>* parent;
+    bool isLeft;
+    return descend(key, parent, isLeft);
 }
 
 /**
@@ -845,29 +1995,174 @@ bool BinarySearchTree<Key, Value>::isBalanced() const
     return isBalanced;
 }
 
+/**
+* Returns the height of the subtree at node and clears isBalanced if any node in
+* it has subtrees whose heights differ by more than one. Walks the tree in
+* post-order with parent pointers and a stack holding one pending left-subtree
+* height per ancestor, so a degenerate (linked-list shaped) tree cannot overflow
+* the call stack. Stops at the first imbalance found, in which case the returned
+* height is only a lower bound.
+*/
 template<typename Key, typename Value>
 int BinarySearchTree<Key, Value>::helperHeight(Node<Key, Value>* node, bool& isBalanced){
     if (node == nullptr){
         return 0; // this node has a height of 0
     }
-    int lHeight = helperHeight(node -> getLeft(), isBalanced);
-    int rHeight = helperHeight(node -> getRight(), isBalanced);
 
+    std::vector<int> heights; //heights of finished subtrees whose parent is not done yet
+    Node<Key, Value>* stop = node -> getParent();
+    Node<Key, Value>* cn = node;
+    Node<Key, Value>* prev = stop;
+
+    while (cn != stop){
+        if (prev == cn -> getParent()){ //first visit: go left
+            prev = cn;
+            if (cn -> getLeft() != nullptr){
+                cn = cn -> getLeft();
+                continue;
+            }
+            heights.push_back(0);
+        }
+        if (prev == cn -> getLeft() || (prev == cn && cn -> getLeft() == nullptr)){ //left done: go right
+            prev = cn;
+            if (cn -> getRight() != nullptr){
+                cn = cn -> getRight();
+                continue;
+            }
+            heights.push_back(0);
+        }
+
+        //both subtrees done
+        int rHeight = heights.back();
+        heights.pop_back();
+        int lHeight = heights.back();
+        heights.pop_back();
+        if (((lHeight - rHeight) >= 2) || ((lHeight - rHeight) <= -2)){
+            isBalanced = false; //violates property that diff in heights must be at most 1
+            return std::max(lHeight, rHeight) + 1;
+        }
+        heights.push_back(std::max(lHeight, rHeight) + 1);
+        prev = cn;
+        cn = cn -> getParent();
+    }
+    return heights.back();
+}
+
+
+/**
+* Appends the nodes of the subtree rooted at node to nodes, in order.
+* Uses parent pointers rather than recursion or a stack.
+*/
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::flattenSubtree(Node<Key, Value>* node, std::vector<Node<Key, Value>*>& nodes)
+{
+    if (node == nullptr){
+        return;
+    }
+    Node<Key, Value>* stop = node -> getParent();
+    Node<Key, Value>* cn = node;
+    while (cn -> getLeft() != nullptr){
+        cn = cn -> getLeft();
+    }
+    while (cn != stop){
+        nodes.push_back(cn);
+        if (cn -> getRight() != nullptr){
+            cn = cn -> getRight();
+            while (cn -> getLeft() != nullptr){
+                cn = cn -> getLeft();
+            }
+        } else {
+            //climb until we come up from a left child (or leave the subtree)
+            Node<Key, Value>* parent = cn -> getParent();
+            while (parent != stop && cn == parent -> getRight()){
+                cn = parent;
+                parent = parent -> getParent();
+            }
+            cn = parent;
+        }
+    }
+}
 
-    if (((lHeight - rHeight) >= 2) || ((lHeight - rHeight) <= -2)){
-        isBalanced = false; //violates property that diff in heights must be at most 1
+/**
+* Rebuilds the subtree rooted at node into a perfectly balanced shape in O(size)
+* time, reusing the existing nodes. The new subtree root takes node's place under
+* its old parent (or becomes root_) and is returned.
+*/
+template<typename Key, typename Value>
+Node<Key, Value>* BinarySearchTree<Key, Value>::rebuildSubtree(Node<Key, Value>* node)
+{
+    if (node == nullptr){
+        return nullptr;
     }
-    int max;
-    if (lHeight > rHeight){
-        max = lHeight;
-    } else if (rHeight > lHeight){
-        max = rHeight;
+    Node<Key, Value>* parent = node -> getParent();
+    bool isLeft = (parent != nullptr) && (parent -> getLeft() == node);
+
+    BST_COUNT(restructures, 1);
+    std::vector<Node<Key, Value>*> nodes;
+    flattenSubtree(node, nodes);
+    int height;
+    Node<Key, Value>* top = linkBalanced(nodes, 0, nodes.size(), parent, height);
+
+    if (parent == nullptr){
+        root_ = top;
+    } else if (isLeft){
+        parent -> setLeft(top);
     } else {
-        max = lHeight;
+        parent -> setRight(top);
+    }
+    return top;
+}
+
+/**
+* Links nodes[lo, hi) into a balanced subtree under parent and returns its root.
+* height is set to the height of the new subtree. Recursion depth is O(log n).
+*/
+template<typename Key, typename Value>
+Node<Key, Value>* BinarySearchTree<Key, Value>::linkBalanced(std::vector<Node<Key, Value>*>& nodes, size_t lo, size_t hi, Node<Key, Value>* parent, int& height)
+{
+    if (lo >= hi){
+        height = 0;
+        return nullptr;
     }
-    return max + 1;
+    size_t mid = lo + (hi - lo) / 2;
+    Node<Key, Value>* top = nodes[mid];
+    int lHeight, rHeight;
+    top -> setParent(parent);
+    top -> setLeft(linkBalanced(nodes, lo, mid, top, lHeight));
+    top -> setRight(linkBalanced(nodes, mid + 1, hi, top, rHeight));
+    rebuiltNode(top, lHeight, rHeight);
+    height = 1 + std::max(lHeight, rHeight);
+    return top;
 }
 
+/**
+* Called for every node placed by linkBalanced, once both of its subtrees are
+* linked, so that subclasses can refresh their per-node metadata.
+*/
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::rebuiltNode(Node<Key, Value>* node, int leftHeight, int rightHeight)
+{
+
+}
+
+/**
+* An iterator to node, which must be in this tree.
+*/
+template<typename Key, typename Value>
+typename BinarySearchTree<Key, Value>::iterator BinarySearchTree<Key, Value>::iteratorAt(Node<Key, Value>* node)
+{
+    return iterator(node);
+}
+
+template<typename Key, typename Value>
+typename Node<Key, Value>::ItemStore* BinarySearchTree<Key, Value>::itemStore()
+{
+#ifdef BST_COLD_VALUE_BYTES
+    return &coldItems_;
+#else
+    return nullptr;
+#endif
+}
 
 template<typename Key, typename Value>
 void BinarySearchTree<Key, Value>::nodeSwap( Node<Key,Value>* n1, Node<Key,Value>* n2)
@@ -959,8 +2254,9 @@ void BinarySearchTree<Key, Value>::nodeSwap( Node<Key,Value>* n1, Node<Key,Value
    Just call it with a node to start printing at, e.g:
    this->printRoot(this->root_) // or any other node pointer
 
-   It will print up to 5 levels of the tree rooted at the passed node,
-   in ASCII graphics format.
+   It will print up to 6 levels of the tree rooted at the passed node,
+   in ASCII graphics format, to std::cout or the stream passed second.
+   Only the printed nodes are visited, so it is cheap on any size of tree.
    We hope it will make debugging easier!
   */
 
@@ -0,0 +1,213 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <deque>
+#include <climits>
+#include <random>
+#include <thread>
+#include <cstdlib>
+#include <string>
+#include "equal-paths.h"
+#include "equal-paths-parallel.h"
+#include "equal-paths-flat.h"
+#include "bench_utils.h"
+using namespace std;
+
+// Throughput benchmark for equalPaths and equalPathsParallel on large trees.
+// Usage: ./equal-paths-bench [depth]
+// Builds a perfect tree of 2^depth - 1 nodes (default depth 22, ~4M nodes)
+// and variants of it, then prints one line per (tree, engine):
+//   perfect        every leaf at the same depth: the whole tree is walked
+//   short-left     the leftmost bottom node lost its children: found at once
+//   short-right    the same at the right edge: found at the very end
+//   random         a random-insertion BST of the same size
+// Throughput is given over the full node count, so an early exit shows up
+// as a very high Mnodes/s. The "level" and "preorder" engines run the flat
+// checkers of equal-paths-flat.h on the tree serialized up front.
+
+// marks a missing child in the serialized trees (keys are never negative here)
+static const int NULL_KEY = INT_MIN;
+
+static void freeTree(Node* root)
+{
+    vector<Node*> pending;
+    if(root != NULL)
+    {
+        pending.push_back(root);
+    }
+    while(!pending.empty())
+    {
+        Node* n = pending.back();
+        pending.pop_back();
+        if(n->left != NULL)
+        {
+            pending.push_back(n->left);
+        }
+        if(n->right != NULL)
+        {
+            pending.push_back(n->right);
+        }
+        delete n;
+    }
+}
+
+// Builds a perfect tree level by level. The nodes just above the leaves are
+// returned in lastParents, left to right.
+static Node* makePerfect(int depth, vector<Node*>& lastParents)
+{
+    vector<Node*> level(1, new Node(0));
+    Node* root = level[0];
+    int key = 1;
+    lastParents.clear();
+    for(int d = 1; d < depth; ++d)
+    {
+        vector<Node*> next;
+        next.reserve(level.size() * 2);
+        for(size_t i = 0; i < level.size(); ++i)
+        {
+            level[i]->left = new Node(key++);
+            level[i]->right = new Node(key++);
+            next.push_back(level[i]->left);
+            next.push_back(level[i]->right);
+        }
+        lastParents.swap(level);
+        level.swap(next);
+    }
+    return root;
+}
+
+// Deletes both children of parent, making it a leaf one level above the others
+static void shorten(Node* parent)
+{
+    delete parent->left;
+    delete parent->right;
+    parent->left = NULL;
+    parent->right = NULL;
+}
+
+static Node* makeRandom(size_t count)
+{
+    vector<int> keys = makeKeyVector<int>(count, KeyOrder::UNIFORM, 370);
+    Node* root = NULL;
+    for(size_t i = 0; i < keys.size(); ++i)
+    {
+        Node** slot = &root;
+        while(*slot != NULL)
+        {
+            slot = (keys[i] < (*slot)->key) ? &(*slot)->left : &(*slot)->right;
+        }
+        *slot = new Node(keys[i]);
+    }
+    return root;
+}
+
+// Level order with a null entry for every missing child of a node
+static void serializeLevelOrder(Node* root, vector<int>& out)
+{
+    out.clear();
+    deque<Node*> queue(1, root);
+    while(!queue.empty())
+    {
+        Node* n = queue.front();
+        queue.pop_front();
+        if(n == NULL)
+        {
+            out.push_back(NULL_KEY);
+            continue;
+        }
+        out.push_back(n->key);
+        queue.push_back(n->left);
+        queue.push_back(n->right);
+    }
+}
+
+// Preorder with a null entry for every empty subtree
+static void serializePreorder(Node* root, vector<int>& out)
+{
+    out.clear();
+    vector<Node*> pending(1, root);
+    while(!pending.empty())
+    {
+        Node* n = pending.back();
+        pending.pop_back();
+        if(n == NULL)
+        {
+            out.push_back(NULL_KEY);
+            continue;
+        }
+        out.push_back(n->key);
+        pending.push_back(n->right);
+        pending.push_back(n->left);
+    }
+}
+
+static void report(const char* tree, string const & engine, size_t nodes, bool result, uint64_t ns)
+{
+    cout << left << setw(13) << tree << setw(10) << engine
+         << right << setw(10) << nodes << setw(7) << (result ? "true" : "false")
+         << setw(10) << fixed << setprecision(2) << ns / 1e6 << " ms"
+         << setw(10) << setprecision(1) << (ns == 0 ? 0.0 : nodes * 1000.0 / ns) << " Mnodes/s" << endl;
+}
+
+static void run(const char* tree, Node* root, size_t nodes, vector<unsigned> const & threadCounts)
+{
+    for(size_t i = 0; i < threadCounts.size(); ++i)
+    {
+        unsigned threads = threadCounts[i];
+        BenchClock clock;
+        bool result = (threads == 1) ? equalPaths(root) : equalPathsParallel(root, threads);
+        report(tree, threads == 1 ? string("serial") : "par" + to_string(threads), nodes, result, clock.elapsedNs());
+    }
+
+    vector<int> flat;
+    serializeLevelOrder(root, flat);
+    BenchClock clock;
+    bool result = equalPathsLevelOrder(flat.data(), flat.size(), NULL_KEY);
+    report(tree, "level", nodes, result, clock.elapsedNs());
+
+    serializePreorder(root, flat);
+    clock.restart();
+    result = equalPathsPreorder(flat.data(), flat.size(), NULL_KEY);
+    report(tree, "preorder", nodes, result, clock.elapsedNs());
+}
+
+int main(int argc, char *argv[])
+{
+    int depth = 22;
+    if(argc > 1)
+    {
+        depth = atoi(argv[1]);
+    }
+    size_t nodes = ((size_t)1 << depth) - 1;
+
+    vector<unsigned> threadCounts(1, 1);
+    unsigned hardware = thread::hardware_concurrency();
+    for(unsigned t = 2; t <= std::max(4u, hardware); t *= 2)
+    {
+        threadCounts.push_back(t);
+    }
+
+    vector<Node*> lastParents;
+    Node* root = makePerfect(depth, lastParents);
+    run("perfect", root, nodes, threadCounts);
+    freeTree(root);
+
+    if(depth >= 3)
+    {
+        root = makePerfect(depth, lastParents);
+        shorten(lastParents.front());
+        run("short-left", root, nodes - 2, threadCounts);
+        freeTree(root);
+
+        root = makePerfect(depth, lastParents);
+        shorten(lastParents.back());
+        run("short-right", root, nodes - 2, threadCounts);
+        freeTree(root);
+    }
+
+    root = makeRandom(nodes);
+    run("random", root, nodes, threadCounts);
+    freeTree(root);
+
+    return 0;
+}
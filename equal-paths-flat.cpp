@@ -0,0 +1,214 @@
+#ifndef RECCHECK
+#include <vector>
+#include <algorithm>
+#include <cstdio>
+#endif
+
+#include "equal-paths-flat.h"
+using namespace std;
+
+
+// With every leaf at the same depth, no node on that deepest level can have a
+// child, and no shallower node can be a leaf. So the tree has equal paths iff
+// the only level holding leaves is the last non-empty one.
+bool equalPathsLevelOrder(const int* keys, size_t count, int nullKey)
+{
+    LevelOrderPathChecker checker(nullKey);
+    checker.feed(keys, count);
+    return checker.finish();
+}
+
+bool equalPathsPreorder(const int* keys, size_t count, int nullKey)
+{
+    PreorderPathChecker checker(nullKey);
+    checker.feed(keys, count);
+    return checker.finish();
+}
+
+LevelOrderPathChecker::LevelOrderPathChecker(int nullKey) :
+    nullKey_(nullKey), started_(false), decided_(false), result_(true),
+    levelRemaining_(0), levelNonNull_(0), leafPairs_(0), haveLeft_(false), leftNull_(0)
+{
+
+}
+
+bool LevelOrderPathChecker::decided() const
+{
+    return decided_;
+}
+
+void LevelOrderPathChecker::feed(const int* keys, size_t count)
+{
+    size_t i = 0;
+    if (!started_ && count > 0){
+        started_ = true;
+        if (keys[0] == nullKey_){
+            decided_ = true; //the empty tree
+            return;
+        }
+        //level 1: the two child slots of the root
+        levelRemaining_ = 2;
+        i = 1;
+    }
+
+    //the non-null entries of each level own two consecutive slots each in
+    //the next one; a pair of null slots is a leaf on the level above
+    while (i < count && !decided_){
+        if (haveLeft_){ //finish a pair split across chunks
+            int rightNull = (keys[i] == nullKey_);
+            leafPairs_ |= leftNull_ & rightNull;
+            levelNonNull_ += 1 - rightNull;
+            haveLeft_ = false;
+            ++i;
+            if (--levelRemaining_ == 0){
+                endLevel();
+            }
+            continue;
+        }
+
+        size_t take = (size_t)min<uint64_t>(count - i, levelRemaining_);
+        size_t pairsEnd = i + (take & ~(size_t)1);
+        uint64_t nonNull = 0;
+        int leafPairs = 0;
+        for (size_t j = i; j < pairsEnd; j += 2){
+            int leftNull = (keys[j] == nullKey_);
+            int rightNull = (keys[j + 1] == nullKey_);
+            leafPairs |= leftNull & rightNull;
+            nonNull += 2 - leftNull - rightNull;
+        }
+        levelNonNull_ += nonNull;
+        leafPairs_ |= leafPairs;
+        if (take & 1){ //the chunk ends in the middle of a pair
+            haveLeft_ = true;
+            leftNull_ = (keys[pairsEnd] == nullKey_);
+            levelNonNull_ += 1 - leftNull_;
+        }
+        i += take;
+        levelRemaining_ -= take;
+        if (levelRemaining_ == 0){
+            endLevel();
+        }
+    }
+}
+
+void LevelOrderPathChecker::endLevel()
+{
+    if (levelNonNull_ == 0){
+        decided_ = true; //the level above was the deepest, so every leaf is on it
+    } else if (leafPairs_){
+        decided_ = true; //a leaf above, but deeper nodes exist
+        result_ = false;
+    } else {
+        levelRemaining_ = 2 * levelNonNull_;
+        levelNonNull_ = 0;
+    }
+}
+
+bool LevelOrderPathChecker::finish()
+{
+    if (!started_ || decided_){
+        return result_;
+    }
+    //the rest of the current level is null
+    if (haveLeft_){
+        leafPairs_ |= leftNull_;
+        haveLeft_ = false;
+        --levelRemaining_;
+    }
+    if (levelRemaining_ >= 2){
+        leafPairs_ = 1;
+    }
+    endLevel();
+    //if it is still open, the next level is missing: every node of this one is a leaf
+    return result_;
+}
+
+PreorderPathChecker::PreorderPathChecker(int nullKey) :
+    nullKey_(nullKey), decided_(false), result_(true),
+    pending_(1, 0), leafDepth_(-1), lastDepth_(-1), nullsSinceLast_(0)
+{
+
+}
+
+bool PreorderPathChecker::decided() const
+{
+    return decided_;
+}
+
+// A node is a leaf iff the two entries right after it (its left and right
+// subtrees) are null, so a leaf is recognised when its second null arrives.
+void PreorderPathChecker::feed(const int* keys, size_t count)
+{
+    for (size_t i = 0; i < count && !decided_; ++i){
+        if (pending_.empty()){
+            decided_ = true; //the tree is complete; the rest is ignored
+            break;
+        }
+        int depth = pending_.back();
+        pending_.pop_back();
+
+        if (keys[i] != nullKey_){
+            lastDepth_ = depth;
+            nullsSinceLast_ = 0;
+            pending_.push_back(depth + 1); //right subtree, read second
+            pending_.push_back(depth + 1); //left subtree, read first
+            continue;
+        }
+        if (++nullsSinceLast_ == 2){
+            if (leafDepth_ < 0){
+                leafDepth_ = lastDepth_;
+            } else if (leafDepth_ != lastDepth_){
+                decided_ = true;
+                result_ = false;
+            }
+        }
+    }
+}
+
+bool PreorderPathChecker::finish()
+{
+    //missing trailing entries are null
+    const int null = nullKey_;
+    while (!decided_ && !pending_.empty()){
+        feed(&null, 1);
+    }
+    return result_;
+}
+
+int equalPathsFile(const char* filename, TreeLayout layout, int nullKey, size_t chunkBytes, uint64_t* bytesRead)
+{
+    FILE* file = fopen(filename, "rb");
+    if (file == nullptr){
+        return -1;
+    }
+    vector<int> chunk(max((size_t)1, chunkBytes / sizeof(int)));
+    LevelOrderPathChecker levelOrder(nullKey);
+    PreorderPathChecker preorder(nullKey);
+    uint64_t total = 0;
+    bool failed = false;
+
+    while (true){
+        size_t got = fread(chunk.data(), sizeof(int), chunk.size(), file);
+        total += got * sizeof(int);
+        if (layout == TreeLayout::LEVEL_ORDER){
+            levelOrder.feed(chunk.data(), got);
+        } else {
+            preorder.feed(chunk.data(), got);
+        }
+        bool decided = (layout == TreeLayout::LEVEL_ORDER) ? levelOrder.decided() : preorder.decided();
+        if (got < chunk.size() || decided){
+            failed = ferror(file) != 0;
+            break;
+        }
+    }
+    fclose(file);
+
+    if (bytesRead != nullptr){
+        *bytesRead = total;
+    }
+    if (failed){
+        return -1;
+    }
+    bool result = (layout == TreeLayout::LEVEL_ORDER) ? levelOrder.finish() : preorder.finish();
+    return result ? 1 : 0;
+}
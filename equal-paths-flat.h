@@ -0,0 +1,109 @@
+#ifndef EQUAL_PATHS_FLAT_H
+#define EQUAL_PATHS_FLAT_H
+
+#ifndef RECCHECK
+#include <cstdlib>
+#include <cstdint>
+#include <vector>
+#endif
+
+/**
+ * Equal-paths checks that run directly on a serialized tree instead of on
+ * Node objects. All of them give exactly the answer equalPaths would give for
+ * the tree the entries describe, without allocating a node per entry.
+ *
+ * Entries equal to nullKey stand for missing children. Entries missing at the
+ * end of the input (trailing nulls left out) count as null, so empty input or
+ * input starting with nullKey is the empty tree. Entries past the end of a
+ * complete tree are ignored.
+ */
+
+/**
+ * @brief Level-order ("breadth first with nulls") layout: the root, then the
+ *        two child slots of every non-null entry of a level, in order, as the
+ *        next level. Scans the array once; the per-level loops have no
+ *        branches on the data, so the compiler can vectorize them.
+ */
+bool equalPathsLevelOrder(const int* keys, size_t count, int nullKey);
+
+/**
+ * @brief Preorder layout: a node, then its left subtree, then its right
+ *        subtree, with a nullKey entry for every empty subtree. Needs
+ *        O(height) extra memory.
+ */
+bool equalPathsPreorder(const int* keys, size_t count, int nullKey);
+
+/**
+ * Incremental level-order checker: feed the entries in chunks of any size,
+ * then call finish(). Keeps O(1) state (the counts for the level being read),
+ * so it suits trees streamed from disk.
+ */
+class LevelOrderPathChecker
+{
+public:
+    LevelOrderPathChecker(int nullKey);
+
+    // Reads the next count entries
+    void feed(const int* keys, size_t count);
+    // True once the answer is known and further entries would be ignored
+    bool decided() const;
+    // Treats any missing entries as null and returns the answer
+    bool finish();
+
+private:
+    void endLevel();
+
+    int nullKey_;
+    bool started_;
+    bool decided_;
+    bool result_;
+    uint64_t levelRemaining_; // slots of the current level not read yet
+    uint64_t levelNonNull_;   // non-null slots read so far in this level
+    int leafPairs_;           // a (null, null) pair was read in this level
+    bool haveLeft_;           // the left slot of a pair was read, the right was not
+    int leftNull_;
+};
+
+/**
+ * Incremental preorder checker, used like LevelOrderPathChecker. Keeps only
+ * the depths of the subtrees still to be read (O(height)) and the first leaf
+ * depth.
+ */
+class PreorderPathChecker
+{
+public:
+    PreorderPathChecker(int nullKey);
+
+    void feed(const int* keys, size_t count);
+    bool decided() const;
+    bool finish();
+
+private:
+    int nullKey_;
+    bool decided_;
+    bool result_;
+    std::vector<int> pending_; // depths of the subtrees still to be read, innermost last
+    int leafDepth_;            // depth of the first leaf, or -1
+    int lastDepth_;            // depth of the most recent non-null entry
+    int nullsSinceLast_;       // null entries read since then
+};
+
+// The serialized layouts equalPathsFile understands
+enum class TreeLayout
+{
+    LEVEL_ORDER,
+    PREORDER
+};
+
+/**
+ * @brief Checks a tree stored in a file as raw native-endian 32-bit entries
+ *        in the given layout, reading chunkBytes at a time. Memory use is the
+ *        chunk plus O(height), however large the file is. Stops reading as
+ *        soon as the answer is known.
+ *
+ * @param bytesRead If not NULL, set to the number of bytes read
+ * @return 1 or 0 for the answer, -1 if the file could not be read
+ */
+int equalPathsFile(const char* filename, TreeLayout layout, int nullKey, size_t chunkBytes, uint64_t* bytesRead);
+
+#endif
@@ -0,0 +1,16 @@
+#ifndef EQUAL_PATHS_PARALLEL_H
+#define EQUAL_PATHS_PARALLEL_H
+
+#include "equal-paths.h"
+
+/**
+ * @brief Same result as equalPaths, but the subtrees below the top few levels
+ *        are checked on up to threads threads at once. Worth it for trees of
+ *        millions of nodes; threads <= 1 just calls equalPaths.
+ *
+ * @param root Pointer to the root of the tree to check for equal paths
+ * @param threads Number of worker threads to use
+ */
+bool equalPathsParallel(Node * root, unsigned threads);
+
+#endif
@@ -0,0 +1,190 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+#include "equal-paths-flat.h"
+#include "bench_utils.h"
+using namespace std;
+
+// Checks equal paths on trees stored on disk, streaming them in fixed-size
+// chunks so the tree never has to fit in memory (see equalPathsFile).
+// Usage:
+//   ./equal-paths-stream write tree.bin level|preorder depth [short]
+//       Writes a perfect tree of 2^depth - 1 nodes in the given layout,
+//       generated on the fly. With "short" the rightmost node above the
+//       leaves has no children, so the answer is false and is only found
+//       at the very end of the file.
+//   ./equal-paths-stream check tree.bin level|preorder [chunkKB]
+//       Prints the answer, the bytes read, the time and the throughput.
+//       Chunks default to 1024 KB. A file written just before is likely
+//       still in the page cache; drop the cache to measure the disk.
+
+// marks a missing child (the generated keys are never negative)
+static const int NULL_KEY = INT_MIN;
+
+// Buffers entries and writes them out a chunk at a time
+class ChunkWriter
+{
+public:
+    ChunkWriter(FILE* file) : file_(file), ok_(true)
+    {
+        buffer_.reserve(1 << 18);
+    }
+
+    void put(int key)
+    {
+        buffer_.push_back(key);
+        if(buffer_.size() == buffer_.capacity())
+        {
+            flush();
+        }
+    }
+
+    void putNulls(uint64_t count)
+    {
+        for(uint64_t i = 0; i < count; ++i)
+        {
+            put(NULL_KEY);
+        }
+    }
+
+    bool flush()
+    {
+        if(!buffer_.empty() && fwrite(buffer_.data(), sizeof(int), buffer_.size(), file_) != buffer_.size())
+        {
+            ok_ = false;
+        }
+        buffer_.clear();
+        return ok_;
+    }
+
+private:
+    FILE* file_;
+    bool ok_;
+    vector<int> buffer_;
+};
+
+static void writeLevelOrder(ChunkWriter& out, int depth, bool shortRight)
+{
+    int key = 0;
+    uint64_t width = 1;
+    for(int d = 0; d < depth; ++d)
+    {
+        // the last two slots of the bottom level belong to the shortened node
+        uint64_t nodes = (shortRight && d == depth - 1) ? width - 2 : width;
+        for(uint64_t i = 0; i < nodes; ++i)
+        {
+            out.put(key++);
+        }
+        out.putNulls(width - nodes);
+        width = 2 * nodes;
+    }
+    out.putNulls(width);
+}
+
+static void writePreorder(ChunkWriter& out, int depth, bool shortRight)
+{
+    int key = 0;
+    // (depth, on the rightmost path) of the subtrees still to be written
+    vector<pair<int, bool> > pending(1, make_pair(0, true));
+    while(!pending.empty())
+    {
+        pair<int, bool> slot = pending.back();
+        pending.pop_back();
+        if(slot.first < 0)
+        {
+            out.put(NULL_KEY);
+            continue;
+        }
+        out.put(key++);
+        bool leaf = (slot.first == depth - 1) || (shortRight && slot.second && slot.first == depth - 2);
+        int childDepth = leaf ? -1 : slot.first + 1;
+        pending.push_back(make_pair(childDepth, slot.second));
+        pending.push_back(make_pair(childDepth, false));
+    }
+}
+
+static bool parseLayout(const char* name, TreeLayout& layout)
+{
+    if(strcmp(name, "level") == 0)
+    {
+        layout = TreeLayout::LEVEL_ORDER;
+        return true;
+    }
+    if(strcmp(name, "preorder") == 0)
+    {
+        layout = TreeLayout::PREORDER;
+        return true;
+    }
+    cerr << "Unknown layout " << name << " (use level or preorder)" << endl;
+    return false;
+}
+
+int main(int argc, char *argv[])
+{
+    TreeLayout layout;
+    if(argc < 4 || !parseLayout(argv[3], layout))
+    {
+        cerr << "Usage: " << argv[0] << " write tree.bin level|preorder depth [short]" << endl;
+        cerr << "       " << argv[0] << " check tree.bin level|preorder [chunkKB]" << endl;
+        return 1;
+    }
+
+    if(strcmp(argv[1], "write") == 0)
+    {
+        int depth = (argc > 4) ? atoi(argv[4]) : 24;
+        bool shortRight = (argc > 5 && strcmp(argv[5], "short") == 0);
+        if(depth < 1 || depth > 31 || (shortRight && depth < 2))
+        {
+            cerr << "Depth must be between 1 (2 with short) and 31" << endl;
+            return 1;
+        }
+        FILE* file = fopen(argv[2], "wb");
+        if(file == NULL)
+        {
+            cerr << "Cannot write " << argv[2] << endl;
+            return 1;
+        }
+        ChunkWriter out(file);
+        if(layout == TreeLayout::LEVEL_ORDER)
+        {
+            writeLevelOrder(out, depth, shortRight);
+        }
+        else
+        {
+            writePreorder(out, depth, shortRight);
+        }
+        bool ok = out.flush();
+        ok = (fclose(file) == 0) && ok;
+        if(!ok)
+        {
+            cerr << "Write to " << argv[2] << " failed" << endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    if(strcmp(argv[1], "check") != 0)
+    {
+        cerr << "Unknown mode " << argv[1] << endl;
+        return 1;
+    }
+    size_t chunkKB = (argc > 4) ? strtoul(argv[4], NULL, 10) : 1024;
+    uint64_t bytes = 0;
+    BenchClock clock;
+    int result = equalPathsFile(argv[2], layout, NULL_KEY, chunkKB * 1024, &bytes);
+    uint64_t ns = clock.elapsedNs();
+    if(result < 0)
+    {
+        cerr << "Cannot read " << argv[2] << endl;
+        return 1;
+    }
+    cout << argv[3] << " " << (result ? "true" : "false") << "  "
+         << bytes << " bytes in " << fixed << setprecision(2) << ns / 1e6 << " ms  "
+         << setprecision(2) << (ns == 0 ? 0.0 : (double)bytes / ns) << " GB/s" << endl;
+    return 0;
+}
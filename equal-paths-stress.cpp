@@ -0,0 +1,69 @@
+#include <iostream>
+#include <cstdlib>
+#include "equal-paths.h"
+#include "bench_utils.h"
+using namespace std;
+
+// Stress test for equalPaths on a degenerate tree: a single zig-zag path of
+// numNodes nodes (default 10M), which a recursive traversal could not handle.
+// Usage: ./equal-paths-stress [numNodes]
+
+static int failures = 0;
+
+static void check(bool ok, const char* what, uint64_t ns)
+{
+    cout << (ok ? "PASS " : "FAIL ") << what << " (" << ns / 1000000 << " ms)" << endl;
+    if(!ok)
+    {
+        ++failures;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    int n = 10000000;
+    if(argc > 1)
+    {
+        n = atoi(argv[1]);
+    }
+    cout << "Chain with " << n << " nodes" << endl;
+
+    BenchClock clock;
+    Node* root = new Node(0);
+    Node* tail = root;
+    for(int i = 1; i < n; ++i)
+    {
+        Node* next = new Node(i);
+        if(i % 2)
+        {
+            tail->left = next;
+        }
+        else
+        {
+            tail->right = next;
+        }
+        tail = next;
+    }
+    check(true, "build chain", clock.elapsedNs());
+
+    clock.restart();
+    bool ok = equalPaths(root);
+    check(ok, "equalPaths on a zig-zag chain", clock.elapsedNs());
+
+    // one extra leaf right below the root makes the leaf depths differ
+    clock.restart();
+    root->right = new Node(-1);
+    ok = !equalPaths(root) || n < 3;
+    check(ok, "equalPaths on a chain with a short branch", clock.elapsedNs());
+
+    delete root->right;
+    root->right = nullptr;
+    while(root != nullptr)
+    {
+        Node* next = (root->left != nullptr) ? root->left : root->right;
+        delete root;
+        root = next;
+    }
+
+    return failures == 0 ? 0 : 1;
+}
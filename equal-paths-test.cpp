@@ -1,6 +1,8 @@
 #include <iostream>
 #include <cstdlib>
 #include "equal-paths.h"
+#include "equal-paths-parallel.h"
+#include "equal-paths-flat.h"
 using namespace std;
 
 
@@ -55,6 +57,42 @@ void test5(const char* msg)
   cout << msg << ": " <<   equalPaths(a) << endl;
 }
 
+void test6(const char* msg)
+{
+  // the tree of test5 again, checked with the parallel engine
+  setNode(a,1,b,c);
+  setNode(b,2,NULL,d);
+  setNode(c,3,NULL,NULL);
+  setNode(d,4,NULL,NULL);
+  cout << msg << ": " <<   equalPathsParallel(a, 2) << endl;
+}
+
+void test7(const char* msg)
+{
+  setNode(a,1,b,c);
+  setNode(b,2,NULL,NULL);
+  setNode(c,3,NULL,NULL);
+  cout << msg << ": " <<   equalPathsParallel(a, 2) << endl;
+}
+
+void test8(const char* msg)
+{
+  // the tree of test5 serialized, -1 marking missing children
+  int levelOrder[] = {1, 2, 3, -1, 4};
+  int preorder[] = {1, 2, -1, 4, -1, -1, 3, -1, -1};
+  cout << msg << ": " << equalPathsLevelOrder(levelOrder, 5, -1)
+       << " " << equalPathsPreorder(preorder, 9, -1) << endl;
+}
+
+void test9(const char* msg)
+{
+  // the tree of test3 serialized
+  int levelOrder[] = {1, 2, 3};
+  int preorder[] = {1, 2, -1, -1, 3, -1, -1};
+  cout << msg << ": " << equalPathsLevelOrder(levelOrder, 3, -1)
+       << " " << equalPathsPreorder(preorder, 7, -1) << endl;
+}
+
 int main()
 {
   a = new Node(1);
@@ -67,6 +105,10 @@ int main()
   test3("Test3");
   test4("Test4");
   test5("Test5");
+  test6("Test6");
+  test7("Test7");
+  test8("Test8");
+  test9("Test9");
  
   delete a;
   delete b;
@@ -1,34 +1,83 @@
 #ifndef RECCHECK
 //if you want to add any #includes like <iostream> you must do them here (before the next endif)
+#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <thread>
 
 #endif
 
 #include "equal-paths.h"
+#include "equal-paths-parallel.h"
 using namespace std;
 
 
 // You may add any prototypes of helper functions here
+static int pathHeight(Node* node, bool& isBalanced, const atomic<bool>* stop);
+
 //Note: this code is adapted from bst.h. Like I mentioned there, I used https://www.youtube.com/watch?v=QfJsau0ItOY to understand the problem
 int helperHeight(Node* node, bool& isBalanced){
+    return pathHeight(node, isBalanced, nullptr);
+}
+
+//Returns the height of the subtree at node and clears isBalanced if two leaves
+//in it sit at different depths. Stops at the first mismatch (the returned height
+//is meaningless then), and also gives up early, without touching isBalanced,
+//once *stop is set by another thread.
+static int pathHeight(Node* node, bool& isBalanced, const atomic<bool>* stop){
     if (node == nullptr){
         return 0; // this node has a height of 0
     }
-    int lHeight = helperHeight(node -> left, isBalanced);
-    int rHeight = helperHeight(node -> right, isBalanced);
 
-    //can only change isBalanced from false to true
-    if ((lHeight != rHeight) && (node -> right != nullptr) && (node -> left != nullptr)){
-        isBalanced = false; 
-    }
-    int max;
-    if (lHeight > rHeight){
-        max = lHeight;
-    } else if (rHeight > lHeight){
-        max = rHeight;
-    } else {
-        max = lHeight;
+    //post-order walk with an explicit stack instead of recursion, so a tree
+    //that is one long path cannot overflow the call stack.
+    //state counts how many of the frame's children have been handled.
+    struct Frame {
+        Node* node;
+        int state;
+        int lHeight;
+    };
+    vector<Frame> stack;
+    stack.push_back(Frame{node, 0, 0});
+    int height = 0; //height of the subtree finished most recently
+    unsigned steps = 0;
+
+    while (!stack.empty()){
+        //checking the shared flag every node would make threads fight over it
+        if (stop != nullptr && (++steps & 4095) == 0 && stop -> load(memory_order_relaxed)){
+            return 0;
+        }
+        Frame& frame = stack.back();
+        Node* cn = frame.node;
+        if (frame.state == 0){
+            frame.state = 1;
+            if (cn -> left != nullptr){
+                stack.push_back(Frame{cn -> left, 0, 0});
+                continue;
+            }
+            height = 0;
+        }
+        if (frame.state == 1){
+            frame.lHeight = height;
+            frame.state = 2;
+            if (cn -> right != nullptr){
+                stack.push_back(Frame{cn -> right, 0, 0});
+                continue;
+            }
+            height = 0;
+        }
+        int lHeight = frame.lHeight;
+        int rHeight = height;
+
+        //can only change isBalanced from true to false
+        if ((lHeight != rHeight) && (cn -> right != nullptr) && (cn -> left != nullptr)){
+            isBalanced = false; 
+            return 0;
+        }
+        height = max(lHeight, rHeight) + 1;
+        stack.pop_back();
     }
-    return max + 1;
+    return height;
 }
 
 bool equalPaths(Node * root)
@@ -45,6 +94,79 @@ bool equalPaths(Node * root)
 
 }
 
+//Splits the top of the tree into enough subtrees to keep every thread busy,
+//measures those subtrees on separate threads, then combines their heights
+//through the few levels above them. The first thread to find a mismatch
+//tells the others to stop.
+bool equalPathsParallel(Node * root, unsigned threads)
+{
+    if (threads <= 1 || root == nullptr){
+        return equalPaths(root);
+    }
 
+    //the top levels in breadth-first order; children are indices into slots,
+    //or -1 for a missing child
+    struct Slot {
+        Node* node;
+        int left;
+        int right;
+        int height;
+    };
+    vector<Slot> slots;
+    slots.push_back(Slot{root, -1, -1, 0});
 
+    //expand whole levels until there are a few subtrees per thread. The level
+    //cap keeps a long thin tree from being expanded in full.
+    size_t levelBegin = 0;
+    size_t numTop = 0;
+    for (int level = 0; level < 32 && levelBegin < slots.size() && slots.size() - levelBegin < 4 * (size_t)threads; ++level){
+        size_t levelEnd = slots.size();
+        for (size_t i = levelBegin; i < levelEnd; ++i){
+            Node* cn = slots[i].node;
+            if (cn -> left != nullptr){
+                slots[i].left = (int)slots.size();
+                slots.push_back(Slot{cn -> left, -1, -1, 0});
+            }
+            if (cn -> right != nullptr){
+                slots[i].right = (int)slots.size();
+                slots.push_back(Slot{cn -> right, -1, -1, 0});
+            }
+        }
+        numTop = levelEnd;
+        levelBegin = levelEnd;
+    }
 
+    //slots from numTop on are the roots of the subtrees handed to threads
+    //stop is only ever set when a mismatch was found
+    atomic<bool> stop(false);
+    vector<thread> workers;
+    for (unsigned t = 0; t < threads; ++t){
+        workers.push_back(thread([&slots, &stop, numTop, threads, t](){
+            for (size_t i = numTop + t; i < slots.size() && !stop.load(memory_order_relaxed); i += threads){
+                bool isBalanced = true;
+                slots[i].height = pathHeight(slots[i].node, isBalanced, &stop);
+                if (!isBalanced){
+                    stop.store(true, memory_order_relaxed);
+                }
+            }
+        }));
+    }
+    for (size_t t = 0; t < workers.size(); ++t){
+        workers[t].join();
+    }
+    if (stop.load()){
+        return false;
+    }
+
+    //children always come after their parent, so a reverse sweep sees them first
+    for (size_t i = numTop; i-- > 0; ){
+        Slot& slot = slots[i];
+        int lHeight = (slot.left < 0) ? 0 : slots[slot.left].height;
+        int rHeight = (slot.right < 0) ? 0 : slots[slot.right].height;
+        if (slot.left >= 0 && slot.right >= 0 && lHeight != rHeight){
+            return false;
+        }
+        slot.height = max(lHeight, rHeight) + 1;
+    }
+    return true;
+}
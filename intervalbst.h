@@ -0,0 +1,296 @@
+#ifndef INTERVALBST_H
+#define INTERVALBST_H
+
+#include <iostream>
+#include <exception>
+#include <cstdlib>
+#include <utility>
+#include <vector>
+#include "bst.h"
+#include "avlbst.h"
+
+/**
+* A closed interval [low, high], the key of an IntervalTree. Intervals sort by
+* low, then by high, so intervals with the same start are distinct keys.
+*/
+template <typename Point>
+struct Interval
+{
+    Interval() : low(), high()
+    {
+    }
+
+    Interval(const Point& lowPoint, const Point& highPoint) : low(lowPoint), high(highPoint)
+    {
+    }
+
+    bool operator<(const Interval& other) const
+    {
+        return low < other.low || (!(other.low < low) && high < other.high);
+    }
+
+    bool operator>(const Interval& other) const
+    {
+        return other < *this;
+    }
+
+    bool operator==(const Interval& other) const
+    {
+        return !(*this < other) && !(other < *this);
+    }
+
+    Point low;
+    Point high;
+};
+
+template <typename Point>
+std::ostream& operator<<(std::ostream& out, const Interval<Point>& interval)
+{
+    return out << "[" << interval.low << ", " << interval.high << "]";
+}
+
+/**
+* An AVLNode keyed by an Interval that also keeps the largest end of any
+* interval in its subtree. IntervalTree keeps that maximum up to date;
+* updateMaxEnd recomputes it from the node's own end and its children's.
+*/
+template <typename Point, typename Value>
+class IntervalNode : public AVLNode<Interval<Point>, Value>
+{
+public:
+    IntervalNode(const Interval<Point>& interval, const Value& value, IntervalNode<Point, Value>* parent, typename Node<Interval<Point>, Value>::ItemStore* store = nullptr);
+    virtual ~IntervalNode();
+
+    const Point& getMaxEnd() const;
+    bool updateMaxEnd();
+
+    virtual IntervalNode<Point, Value>* getParent() const override;
+    virtual IntervalNode<Point, Value>* getLeft() const override;
+    virtual IntervalNode<Point, Value>* getRight() const override;
+
+protected:
+    Point maxEnd_;
+};
+
+/*
+  -------------------------------------------------
+  Begin implementations for the IntervalNode class.
+  -------------------------------------------------
+*/
+
+template<class Point, class Value>
+IntervalNode<Point, Value>::IntervalNode(const Interval<Point>& interval, const Value& value, IntervalNode<Point, Value>* parent, typename Node<Interval<Point>, Value>::ItemStore* store) :
+    AVLNode<Interval<Point>, Value>(interval, value, parent, store), maxEnd_(interval.high)
+{
+
+}
+
+template<class Point, class Value>
+IntervalNode<Point, Value>::~IntervalNode()
+{
+
+}
+
+/**
+* The largest end of the intervals in this node's subtree.
+*/
+template<class Point, class Value>
+const Point& IntervalNode<Point, Value>::getMaxEnd() const
+{
+    return maxEnd_;
+}
+
+/**
+* Recomputes the subtree's largest end from this node and its children, which
+* must be up to date already. Returns whether it changed.
+*/
+template<class Point, class Value>
+bool IntervalNode<Point, Value>::updateMaxEnd()
+{
+    const Point* maxEnd = &(this -> getKey().high);
+    if (getLeft() != nullptr && *maxEnd < getLeft() -> maxEnd_){
+        maxEnd = &(getLeft() -> maxEnd_);
+    }
+    if (getRight() != nullptr && *maxEnd < getRight() -> maxEnd_){
+        maxEnd = &(getRight() -> maxEnd_);
+    }
+    if (!(*maxEnd < maxEnd_) && !(maxEnd_ < *maxEnd)){
+        return false;
+    }
+    maxEnd_ = *maxEnd;
+    return true;
+}
+
+template<class Point, class Value>
+IntervalNode<Point, Value> *IntervalNode<Point, Value>::getParent() const
+{
+    return static_cast<IntervalNode<Point, Value>*>(Node<Interval<Point>, Value>::getParent());
+}
+
+template<class Point, class Value>
+IntervalNode<Point, Value> *IntervalNode<Point, Value>::getLeft() const
+{
+    return static_cast<IntervalNode<Point, Value>*>(this->getChild(0));
+}
+
+template<class Point, class Value>
+IntervalNode<Point, Value> *IntervalNode<Point, Value>::getRight() const
+{
+    return static_cast<IntervalNode<Point, Value>*>(this->getChild(1));
+}
+
+/*
+  -----------------------------------------------
+  End implementations for the IntervalNode class.
+  -----------------------------------------------
+*/
+
+
+/**
+* An AVL tree keyed by closed intervals (several of which may share a start)
+* that also answers which intervals overlap a range or contain a point.
+*
+* Every node knows the largest end in its subtree, so a query skips any
+* subtree that ends before the range starts, and stops at the first node that
+* starts after it. Intervals starting inside the range are a contiguous run
+* in key order and cost O(1) each after an O(log n) descent; each one that
+* starts before the range and reaches into it adds at most one path of
+* O(log n) nodes. The maxima are kept through inserts, removes, rotations and
+* rebuilds, at O(log n) extra per update.
+*
+* An interval's low must not be greater than its high. Node handles must come
+* from another IntervalTree with the same types.
+*/
+template <class Point, class Value>
+class IntervalTree : public AVLTree<Interval<Point>, Value>
+{
+public:
+    typedef typename AVLTree<Interval<Point>, Value>::iterator iterator;
+
+    void findOverlapping(const Point& low, const Point& high, std::vector<iterator>& out) const;
+    void findContaining(const Point& point, std::vector<iterator>& out) const;
+
+protected:
+    virtual Node<Interval<Point>, Value>* insertAt(Node<Interval<Point>, Value>* parent, bool isLeft, const std::pair<const Interval<Point>, Value>& new_item);
+    virtual void linkNode(Node<Interval<Point>, Value>* parent, bool isLeft, Node<Interval<Point>, Value>* node);
+    virtual void unlinkNode(Node<Interval<Point>, Value>* node);
+    virtual void rotated(AVLNode<Interval<Point>, Value>* top, AVLNode<Interval<Point>, Value>* child);
+    virtual void rebuiltNode(Node<Interval<Point>, Value>* node, int leftHeight, int rightHeight);
+};
+
+/**
+* Stores an iterator to every interval that shares at least one point with
+* [low, high] in out, in key order.
+*/
+template<class Point, class Value>
+void IntervalTree<Point, Value>::findOverlapping(const Point& low, const Point& high, std::vector<iterator>& out) const
+{
+    out.clear();
+    //an in-order walk that never enters a subtree ending before low
+    std::vector<IntervalNode<Point, Value>*> pending;
+    IntervalNode<Point, Value>* cn = static_cast<IntervalNode<Point, Value>*>(this -> root_);
+    while (true){
+        while (cn != nullptr && !(cn -> getMaxEnd() < low)){
+            pending.push_back(cn);
+            cn = cn -> getLeft();
+        }
+        if (pending.empty()){
+            return;
+        }
+        cn = pending.back();
+        pending.pop_back();
+        if (high < cn -> getKey().low){
+            return; //this node and every later one start after high
+        }
+        if (!(cn -> getKey().high < low)){
+            out.push_back(this -> iteratorAt(cn));
+        }
+        cn = cn -> getRight();
+    }
+}
+
+/**
+* Stores an iterator to every interval that contains point in out, in key order.
+*/
+template<class Point, class Value>
+void IntervalTree<Point, Value>::findContaining(const Point& point, std::vector<iterator>& out) const
+{
+    findOverlapping(point, point, out);
+}
+
+template<class Point, class Value>
+Node<Interval<Point>, Value>* IntervalTree<Point, Value>::insertAt(Node<Interval<Point>, Value>* parent, bool isLeft, const std::pair<const Interval<Point>, Value>& new_item)
+{
+    IntervalNode<Point, Value>* new_node = new IntervalNode<Point, Value>(new_item.first, new_item.second, static_cast<IntervalNode<Point, Value>*>(parent), this -> itemStore());
+    BST_COUNT(allocations, 1);
+    linkNode(parent, isLeft, new_node);
+    return new_node;
+}
+
+/**
+* Links a leaf and raises the maxima above it before rebalancing, so that the
+* rotations of insertFix start from correct children. Adding an interval can
+* only raise maxima, so the walk stops at the first ancestor that already
+* reaches as far.
+*/
+template<class Point, class Value>
+void IntervalTree<Point, Value>::linkNode(Node<Interval<Point>, Value>* parent, bool isLeft, Node<Interval<Point>, Value>* node)
+{
+    IntervalNode<Point, Value>* new_node = static_cast<IntervalNode<Point, Value>*>(node);
+    new_node -> updateMaxEnd(); //a node from a handle still has its old subtree's maximum
+    this -> attachNode(parent, isLeft, node);
+    IntervalNode<Point, Value>* update = new_node -> getParent();
+    while (update != nullptr && update -> updateMaxEnd()){
+        update = update -> getParent();
+    }
+    this -> insertFix(new_node);
+}
+
+/**
+* Unlinks node with the AVL removal, then recomputes every maximum from the
+* lowest node whose subtree lost an interval up to the root. removeFix may
+* have rotated nodes on that path while their children were still stale, so
+* the walk cannot stop early.
+*/
+template<class Point, class Value>
+void IntervalTree<Point, Value>::unlinkNode(Node<Interval<Point>, Value>* node)
+{
+    IntervalNode<Point, Value>* cn = static_cast<IntervalNode<Point, Value>*>(node);
+    //the AVL removal takes out the predecessor's position when node has two
+    //children; the predecessor itself moves up into node's place
+    IntervalNode<Point, Value>* update = cn -> getParent();
+    if ((cn -> getLeft() != nullptr) && (cn -> getRight() != nullptr)){
+        IntervalNode<Point, Value>* swap = cn -> getLeft();
+        while (swap -> getRight() != nullptr){
+            swap = swap -> getRight();
+        }
+        update = (swap -> getParent() == cn) ? swap : swap -> getParent();
+    }
+    AVLTree<Interval<Point>, Value>::unlinkNode(node);
+    while (update != nullptr){
+        update -> updateMaxEnd();
+        update = update -> getParent();
+    }
+}
+
+/**
+* top is now below child, so its maximum is recomputed first.
+*/
+template<class Point, class Value>
+void IntervalTree<Point, Value>::rotated(AVLNode<Interval<Point>, Value>* top, AVLNode<Interval<Point>, Value>* child)
+{
+    static_cast<IntervalNode<Point, Value>*>(top) -> updateMaxEnd();
+    static_cast<IntervalNode<Point, Value>*>(child) -> updateMaxEnd();
+}
+
+/**
+* linkBalanced places nodes bottom-up, so the children are already done.
+*/
+template<class Point, class Value>
+void IntervalTree<Point, Value>::rebuiltNode(Node<Interval<Point>, Value>* node, int leftHeight, int rightHeight)
+{
+    AVLTree<Interval<Point>, Value>::rebuiltNode(node, leftHeight, rightHeight);
+    static_cast<IntervalNode<Point, Value>*>(node) -> updateMaxEnd();
+}
+
+#endif
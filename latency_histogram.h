@@ -0,0 +1,283 @@
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <utility>
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#define LATENCY_USE_RDTSC
+#endif
+
+// Per-operation latency histograms for the trees.
+// Wrap any tree in LatencyTrackedTree to time every find, insert and remove
+// it performs, then read p50/p90/p99/max per operation type from it.
+
+// Cheap timestamps for timing single operations. Uses the CPU timestamp
+// counter where available (a couple of ns to read) and steady_clock elsewhere.
+// Ticks are converted to nanoseconds only when reporting.
+class LatencyClock
+{
+public:
+    static uint64_t now()
+    {
+#ifdef LATENCY_USE_RDTSC
+        return __rdtsc();
+#else
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+    }
+
+    // Nanoseconds per tick, measured once against steady_clock over ~10ms
+    static double nsPerTick()
+    {
+#ifdef LATENCY_USE_RDTSC
+        static const double ratio = calibrate();
+        return ratio;
+#else
+        return 1.0;
+#endif
+    }
+
+private:
+    static double calibrate()
+    {
+        std::chrono::steady_clock::time_point wallStart = std::chrono::steady_clock::now();
+        uint64_t tickStart = now();
+        std::chrono::steady_clock::time_point wallEnd;
+        do
+        {
+            wallEnd = std::chrono::steady_clock::now();
+        }
+        while(wallEnd - wallStart < std::chrono::milliseconds(10));
+        uint64_t ticks = now() - tickStart;
+        uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(wallEnd - wallStart).count();
+        return ticks == 0 ? 1.0 : (double)ns / ticks;
+    }
+};
+
+// A log-linear histogram of durations in ticks: every power of two is split
+// into 4 sub-buckets, so a reported percentile is within 25% of the true value
+// while recording stays a handful of instructions and the whole histogram
+// fits in 2KB.
+class LatencyHistogram
+{
+public:
+    static const int SUB_BUCKETS = 4;
+    static const int NUM_BUCKETS = 64 * SUB_BUCKETS;
+
+    LatencyHistogram()
+    {
+        clear();
+    }
+
+    void clear()
+    {
+        for(int i = 0; i < NUM_BUCKETS; ++i)
+        {
+            buckets_[i] = 0;
+        }
+        count_ = 0;
+        max_ = 0;
+    }
+
+    void record(uint64_t ticks)
+    {
+        ++buckets_[bucketOf(ticks)];
+        ++count_;
+        if(ticks > max_)
+        {
+            max_ = ticks;
+        }
+    }
+
+    // Adds every sample of other to this histogram
+    void merge(LatencyHistogram const & other)
+    {
+        for(int i = 0; i < NUM_BUCKETS; ++i)
+        {
+            buckets_[i] += other.buckets_[i];
+        }
+        count_ += other.count_;
+        if(other.max_ > max_)
+        {
+            max_ = other.max_;
+        }
+    }
+
+    uint64_t count() const
+    {
+        return count_;
+    }
+
+    uint64_t maxTicks() const
+    {
+        return max_;
+    }
+
+    // The smallest bucket bound that at least fraction (0..1] of the samples
+    // fall under, capped at the largest sample. 0 if nothing was recorded.
+    uint64_t percentileTicks(double fraction) const
+    {
+        if(count_ == 0)
+        {
+            return 0;
+        }
+        uint64_t rank = (uint64_t)(fraction * count_ + 0.5);
+        if(rank < 1)
+        {
+            rank = 1;
+        }
+        uint64_t seen = 0;
+        for(int i = 0; i < NUM_BUCKETS; ++i)
+        {
+            seen += buckets_[i];
+            if(seen >= rank)
+            {
+                uint64_t bound = bucketUpperBound(i);
+                return bound < max_ ? bound : max_;
+            }
+        }
+        return max_;
+    }
+
+    double percentileNs(double fraction) const
+    {
+        return percentileTicks(fraction) * LatencyClock::nsPerTick();
+    }
+
+    double maxNs() const
+    {
+        return max_ * LatencyClock::nsPerTick();
+    }
+
+private:
+    static int bucketOf(uint64_t ticks)
+    {
+        if(ticks < SUB_BUCKETS)
+        {
+            return (int)ticks;
+        }
+        int exponent = 63 - __builtin_clzll(ticks);
+        int sub = (int)(ticks >> (exponent - 2)) & (SUB_BUCKETS - 1);
+        return (exponent - 1) * SUB_BUCKETS + sub;
+    }
+
+    // the largest value that lands in bucket
+    static uint64_t bucketUpperBound(int bucket)
+    {
+        if(bucket < SUB_BUCKETS)
+        {
+            return bucket;
+        }
+        int exponent = bucket / SUB_BUCKETS + 1;
+        uint64_t sub = bucket % SUB_BUCKETS;
+        uint64_t width = (uint64_t)1 << (exponent - 2);
+        return (SUB_BUCKETS + sub) * width + (width - 1);
+    }
+
+    uint64_t buckets_[NUM_BUCKETS];
+    uint64_t count_;
+    uint64_t max_;
+};
+
+// The operation types LatencyTrackedTree keeps a histogram for.
+enum class TreeOp
+{
+    FIND,
+    INSERT,
+    REMOVE,
+    NUM_OPS
+};
+
+inline const char* treeOpName(TreeOp op)
+{
+    switch(op)
+    {
+        case TreeOp::FIND: return "find";
+        case TreeOp::INSERT: return "insert";
+        case TreeOp::REMOVE: return "remove";
+        case TreeOp::NUM_OPS: break;
+    }
+    return "?";
+}
+
+// Writes one line per operation type that has samples, e.g.
+//   prefix op=remove count=1000 p50_ns=88 p90_ns=120 p99_ns=352 max_ns=4021
+// Space-separated key=value pairs so monitoring scrapers can pick them up.
+inline void printLatencyHistograms(std::ostream& out, const char* prefix, LatencyHistogram const histograms[])
+{
+    for(int op = 0; op < (int)TreeOp::NUM_OPS; ++op)
+    {
+        LatencyHistogram const & histogram = histograms[op];
+        if(histogram.count() == 0)
+        {
+            continue;
+        }
+        out << prefix << " op=" << treeOpName((TreeOp)op)
+            << " count=" << histogram.count()
+            << " p50_ns=" << (uint64_t)histogram.percentileNs(0.50)
+            << " p90_ns=" << (uint64_t)histogram.percentileNs(0.90)
+            << " p99_ns=" << (uint64_t)histogram.percentileNs(0.99)
+            << " max_ns=" << (uint64_t)histogram.maxNs() << "\n";
+    }
+}
+
+// One of the trees (e.g. LatencyTrackedTree<AVLTree, int, int>) with every
+// find, insert and remove timed into a per-instance histogram. It is used
+// exactly like Tree<Key, Value>; the timing costs two timestamp reads and a
+// bucket increment per call. Hinted inserts are not timed.
+template<template<typename, typename> class Tree, typename Key, typename Value>
+class LatencyTrackedTree : public Tree<Key, Value>
+{
+public:
+    typedef Tree<Key, Value> Base;
+    using Base::insert;
+
+    virtual void insert(const std::pair<const Key, Value>& item)
+    {
+        uint64_t start = LatencyClock::now();
+        Base::insert(item);
+        histograms_[(int)TreeOp::INSERT].record(LatencyClock::now() - start);
+    }
+
+    virtual void remove(const Key& key)
+    {
+        uint64_t start = LatencyClock::now();
+        Base::remove(key);
+        histograms_[(int)TreeOp::REMOVE].record(LatencyClock::now() - start);
+    }
+
+    typename Base::iterator find(const Key& key)
+    {
+        uint64_t start = LatencyClock::now();
+        typename Base::iterator it = Base::find(key);
+        histograms_[(int)TreeOp::FIND].record(LatencyClock::now() - start);
+        return it;
+    }
+
+    LatencyHistogram const & latency(TreeOp op) const
+    {
+        return histograms_[(int)op];
+    }
+
+    void resetLatency()
+    {
+        for(int op = 0; op < (int)TreeOp::NUM_OPS; ++op)
+        {
+            histograms_[op].clear();
+        }
+    }
+
+    void printLatency(std::ostream& out, const char* prefix) const
+    {
+        printLatencyHistograms(out, prefix, histograms_);
+    }
+
+private:
+    LatencyHistogram histograms_[(int)TreeOp::NUM_OPS];
+};
+
+#endif
@@ -0,0 +1,360 @@
+#ifndef OP_TRACE_H
+#define OP_TRACE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <vector>
+#include <utility>
+#include <type_traits>
+
+// Operation traces: a compact binary log of the find/insert/remove/clear
+// calls made on a tree, so real workloads can be replayed against any tree
+// engine (see bst-replay.cpp).
+//
+// Format: the 8-byte magic "BSTTRC01", then one record per operation:
+//   1 byte       operation (TraceOp)
+//   varint       key, zigzag-encoded difference from the previous key
+//   varint       value, zigzag-encoded (insert only)
+// Clear records have no key. Keys that move in small steps (sorted appends,
+// scans) take one or two bytes, so a record is usually 2-4 bytes.
+// Keys and values must be integers of at most 64 bits.
+
+static const char TRACE_MAGIC[8] = {'B', 'S', 'T', 'T', 'R', 'C', '0', '1'};
+
+enum class TraceOp : uint8_t
+{
+    FIND = 'F',
+    INSERT = 'I',
+    REMOVE = 'R',
+    CLEAR = 'C'
+};
+
+// One decoded operation
+struct TraceRecord
+{
+    TraceOp op;
+    int64_t key;
+    int64_t value;
+};
+
+class TraceWriter
+{
+public:
+    // Writes the header to out; out must outlive the writer
+    TraceWriter(std::ostream& out):
+    out_(out), lastKey_(0), count_(0)
+    {
+        out_.write(TRACE_MAGIC, sizeof(TRACE_MAGIC));
+    }
+
+    void record(TraceOp op, int64_t key, int64_t value)
+    {
+        out_.put((char)op);
+        if(op != TraceOp::CLEAR)
+        {
+            //the difference is taken modulo 2^64 so that extreme keys cannot overflow
+            writeVarint(zigzag((int64_t)((uint64_t)key - (uint64_t)lastKey_)));
+            lastKey_ = key;
+        }
+        if(op == TraceOp::INSERT)
+        {
+            writeVarint(zigzag(value));
+        }
+        ++count_;
+    }
+
+    uint64_t count() const
+    {
+        return count_;
+    }
+
+private:
+    static uint64_t zigzag(int64_t value)
+    {
+        return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+    }
+
+    void writeVarint(uint64_t value)
+    {
+        while(value >= 0x80)
+        {
+            out_.put((char)(value | 0x80));
+            value >>= 7;
+        }
+        out_.put((char)value);
+    }
+
+    std::ostream& out_;
+    int64_t lastKey_;
+    uint64_t count_;
+};
+
+// Reads a whole trace into memory so replays time only the tree.
+// Returns false if the header is wrong or a record is cut short.
+inline bool readTrace(std::istream& in, std::vector<TraceRecord>& records)
+{
+    char magic[sizeof(TRACE_MAGIC)];
+    if(!in.read(magic, sizeof(magic)) || memcmp(magic, TRACE_MAGIC, sizeof(magic)) != 0)
+    {
+        return false;
+    }
+
+    struct Varint
+    {
+        static bool read(std::istream& in, int64_t& out)
+        {
+            uint64_t value = 0;
+            for(int shift = 0; shift < 64; shift += 7)
+            {
+                int byte = in.get();
+                if(byte == EOF)
+                {
+                    return false;
+                }
+                value |= (uint64_t)(byte & 0x7f) << shift;
+                if(!(byte & 0x80))
+                {
+                    out = (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+                    return true;
+                }
+            }
+            return false;
+        }
+    };
+
+    int64_t lastKey = 0;
+    int op;
+    while((op = in.get()) != EOF)
+    {
+        TraceRecord record;
+        record.op = (TraceOp)op;
+        record.key = 0;
+        record.value = 0;
+        if(record.op != TraceOp::FIND && record.op != TraceOp::INSERT &&
+           record.op != TraceOp::REMOVE && record.op != TraceOp::CLEAR)
+        {
+            return false;
+        }
+        if(record.op != TraceOp::CLEAR)
+        {
+            int64_t delta;
+            if(!Varint::read(in, delta))
+            {
+                return false;
+            }
+            record.key = (int64_t)((uint64_t)lastKey + (uint64_t)delta);
+            lastKey = record.key;
+        }
+        if(record.op == TraceOp::INSERT && !Varint::read(in, record.value))
+        {
+            return false;
+        }
+        records.push_back(record);
+    }
+    return true;
+}
+
+// One of the trees (e.g. TracedTree<AVLTree, int, int>) that logs every
+// find, insert, remove and clear to a TraceWriter while behaving exactly
+// like Tree<Key, Value>. Recording is off until setTrace is called.
+template<template<typename, typename> class Tree, typename Key, typename Value>
+class TracedTree : public Tree<Key, Value>
+{
+    static_assert(std::is_integral<Key>::value && std::is_integral<Value>::value,
+                  "traces store integer keys and values");
+
+public:
+    typedef Tree<Key, Value> Base;
+    using Base::insert;
+
+    TracedTree():
+    trace_(NULL)
+    {
+    }
+
+    // Starts logging to trace (NULL stops it)
+    void setTrace(TraceWriter* trace)
+    {
+        trace_ = trace;
+    }
+
+    virtual void insert(const std::pair<const Key, Value>& item)
+    {
+        if(trace_ != NULL)
+        {
+            trace_->record(TraceOp::INSERT, (int64_t)item.first, (int64_t)item.second);
+        }
+        Base::insert(item);
+    }
+
+    // A hinted insert is logged as a plain insert; the hint only affects speed
+    typename Base::iterator insert(typename Base::iterator hint, const std::pair<const Key, Value>& item)
+    {
+        if(trace_ != NULL)
+        {
+            trace_->record(TraceOp::INSERT, (int64_t)item.first, (int64_t)item.second);
+        }
+        return Base::insert(hint, item);
+    }
+
+    virtual void remove(const Key& key)
+    {
+        if(trace_ != NULL)
+        {
+            trace_->record(TraceOp::REMOVE, (int64_t)key, 0);
+        }
+        Base::remove(key);
+    }
+
+    // Erases are logged as removes of the erased keys
+    typename Base::iterator erase(typename Base::iterator pos)
+    {
+        if(trace_ != NULL && pos != this->end())
+        {
+            trace_->record(TraceOp::REMOVE, (int64_t)pos->first, 0);
+        }
+        return Base::erase(pos);
+    }
+
+    typename Base::iterator erase(typename Base::iterator first, typename Base::iterator last)
+    {
+        for(typename Base::iterator it = first; trace_ != NULL && it != last; ++it)
+        {
+            trace_->record(TraceOp::REMOVE, (int64_t)it->first, 0);
+        }
+        return Base::erase(first, last);
+    }
+
+    template<typename Predicate>
+    size_t eraseIf(Predicate pred)
+    {
+        TraceWriter* trace = trace_;
+        return Base::eraseIf([trace, &pred](std::pair<const Key, Value>& item) -> bool
+        {
+            bool erased = pred(item);
+            if(erased && trace != NULL)
+            {
+                trace->record(TraceOp::REMOVE, (int64_t)item.first, 0);
+            }
+            return erased;
+        });
+    }
+
+    // Moving a node out is logged as a remove and moving one in as an insert,
+    // so replaying the trace of either tree rebuilds its contents
+    typename Base::node_type extract(const Key& key)
+    {
+        typename Base::node_type handle = Base::extract(key);
+        if(trace_ != NULL && !handle.empty())
+        {
+            trace_->record(TraceOp::REMOVE, (int64_t)key, 0);
+        }
+        return handle;
+    }
+
+    typename Base::node_type extract(typename Base::iterator pos)
+    {
+        if(trace_ != NULL && pos != this->end())
+        {
+            trace_->record(TraceOp::REMOVE, (int64_t)pos->first, 0);
+        }
+        return Base::extract(pos);
+    }
+
+    std::pair<typename Base::iterator, bool> insert(typename Base::node_type&& handle)
+    {
+        std::pair<typename Base::iterator, bool> result = Base::insert(std::move(handle));
+        if(trace_ != NULL && result.second)
+        {
+            trace_->record(TraceOp::INSERT, (int64_t)result.first->first, (int64_t)result.first->second);
+        }
+        return result;
+    }
+
+    // The single-descent updates are logged as the insert of the value they
+    // leave behind, or as a find when they change nothing. Writes made later
+    // through the reference getOrInsert returns are not seen.
+    std::pair<typename Base::iterator, bool> insertOrAssign(const Key& key, const Value& value)
+    {
+        if(trace_ != NULL)
+        {
+            trace_->record(TraceOp::INSERT, (int64_t)key, (int64_t)value);
+        }
+        return Base::insertOrAssign(key, value);
+    }
+
+    Value& getOrInsert(const Key& key)
+    {
+        std::pair<typename Base::iterator, bool> result = Base::upsert(key, Value(), [](Value&) {});
+        if(trace_ != NULL)
+        {
+            logUpdate(key, result.first->second, result.second);
+        }
+        return result.first->second;
+    }
+
+    template<typename Modifier>
+    bool modify(const Key& key, Modifier fn)
+    {
+        Value value = Value();
+        bool found = Base::modify(key, [&fn, &value](Value& stored)
+        {
+            fn(stored);
+            value = stored;
+        });
+        if(trace_ != NULL)
+        {
+            logUpdate(key, value, found);
+        }
+        return found;
+    }
+
+    template<typename Modifier>
+    std::pair<typename Base::iterator, bool> upsert(const Key& key, const Value& initial, Modifier fn)
+    {
+        std::pair<typename Base::iterator, bool> result = Base::upsert(key, initial, fn);
+        if(trace_ != NULL)
+        {
+            trace_->record(TraceOp::INSERT, (int64_t)key, (int64_t)result.first->second);
+        }
+        return result;
+    }
+
+    typename Base::iterator find(const Key& key)
+    {
+        if(trace_ != NULL)
+        {
+            trace_->record(TraceOp::FIND, (int64_t)key, 0);
+        }
+        return Base::find(key);
+    }
+
+    void clear()
+    {
+        if(trace_ != NULL)
+        {
+            trace_->record(TraceOp::CLEAR, 0, 0);
+        }
+        Base::clear();
+    }
+
+private:
+    void logUpdate(const Key& key, const Value& value, bool changed)
+    {
+        if(changed)
+        {
+            trace_->record(TraceOp::INSERT, (int64_t)key, (int64_t)value);
+        }
+        else
+        {
+            trace_->record(TraceOp::FIND, (int64_t)key, 0);
+        }
+    }
+
+    TraceWriter* trace_;
+};
+
+#endif
@@ -0,0 +1,184 @@
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <cstdint>
+#include <cstring>
+#include <chrono>
+#if defined(__linux__)
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+// Hardware performance counters for the current thread, read through the
+// Linux perf_event_open syscall. Only user-space events are counted, which
+// perf_event_paranoid <= 2 allows without root.
+// The events are opened as one group, which the kernel schedules onto the
+// PMU all at once, and read together with the time the group was enabled
+// and the time it actually ran. When other events compete for the counters
+// (the NMI watchdog, or a VM with few of them) the kernel multiplexes the
+// group and it runs for only part of a sample; such a sample's counts are
+// not used (counted is false) rather than extrapolated. The libperf in the
+// CS104 test suite (hw4_tests.tar.gz) opens each event on its own and reads
+// bare counts, which cannot tell when that happened, so it is not used here.
+// When the counters cannot be opened (no permission, a VM without a PMU, or
+// not Linux), available() is false and only the wall time is measured.
+
+// The events PerfCounters collects, in the order they are reported.
+enum class PerfEvent
+{
+    INSTRUCTIONS,
+    CYCLES,
+    CACHE_MISSES,
+    BRANCH_MISSES,
+    NUM_EVENTS
+};
+
+inline const char* perfEventName(PerfEvent event)
+{
+    switch(event)
+    {
+        case PerfEvent::INSTRUCTIONS: return "instructions";
+        case PerfEvent::CYCLES: return "cycles";
+        case PerfEvent::CACHE_MISSES: return "cache_misses";
+        case PerfEvent::BRANCH_MISSES: return "branch_misses";
+        case PerfEvent::NUM_EVENTS: break;
+    }
+    return "?";
+}
+
+// Counts between start() and stop(), plus the elapsed wall time
+struct PerfSample
+{
+    uint64_t counts[(int)PerfEvent::NUM_EVENTS];
+    uint64_t ns;
+    bool counted; // the counters ran for the whole sample; counts are 0 otherwise
+};
+
+class PerfCounters
+{
+public:
+    PerfCounters():
+    available_(false)
+    {
+        for(int i = 0; i < (int)PerfEvent::NUM_EVENTS; ++i)
+        {
+            fds_[i] = -1;
+        }
+#if defined(__linux__)
+        const uint64_t configs[] = {
+            PERF_COUNT_HW_INSTRUCTIONS,
+            PERF_COUNT_HW_CPU_CYCLES,
+            PERF_COUNT_HW_CACHE_MISSES,
+            PERF_COUNT_HW_BRANCH_MISSES
+        };
+        available_ = true;
+        for(int i = 0; i < (int)PerfEvent::NUM_EVENTS; ++i)
+        {
+            struct perf_event_attr attr;
+            memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = configs[i];
+            attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            attr.disabled = (i == 0); // the others follow the group leader
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            fds_[i] = (int)syscall(__NR_perf_event_open, &attr, 0, -1, i == 0 ? -1 : fds_[0], 0);
+            if(fds_[i] < 0)
+            {
+                available_ = false;
+                break;
+            }
+        }
+        if(!available_)
+        {
+            closeAll();
+        }
+#endif
+    }
+
+    ~PerfCounters()
+    {
+        closeAll();
+    }
+
+    bool available() const
+    {
+        return available_;
+    }
+
+    void start()
+    {
+#if defined(__linux__)
+        if(available_)
+        {
+            ioctl(fds_[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+            ioctl(fds_[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+        }
+#endif
+        start_ = std::chrono::steady_clock::now();
+    }
+
+    PerfSample stop()
+    {
+        PerfSample sample;
+        sample.ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_).count();
+        sample.counted = false;
+        for(int i = 0; i < (int)PerfEvent::NUM_EVENTS; ++i)
+        {
+            sample.counts[i] = 0;
+        }
+#if defined(__linux__)
+        if(available_)
+        {
+            ioctl(fds_[0], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+            // the layout PERF_FORMAT_GROUP reads: the number of events, the
+            // times, then one value per event in the order they were opened
+            struct
+            {
+                uint64_t nr;
+                uint64_t timeEnabled;
+                uint64_t timeRunning;
+                uint64_t values[(int)PerfEvent::NUM_EVENTS];
+            } group;
+            if(read(fds_[0], &group, sizeof(group)) == (ssize_t)sizeof(group)
+               && group.nr == (uint64_t)PerfEvent::NUM_EVENTS
+               && group.timeRunning > 0 && group.timeRunning == group.timeEnabled)
+            {
+                sample.counted = true;
+                for(int i = 0; i < (int)PerfEvent::NUM_EVENTS; ++i)
+                {
+                    sample.counts[i] = group.values[i];
+                }
+            }
+        }
+#endif
+        return sample;
+    }
+
+private:
+    PerfCounters(PerfCounters const &);
+    PerfCounters& operator=(PerfCounters const &);
+
+    void closeAll()
+    {
+        for(int i = 0; i < (int)PerfEvent::NUM_EVENTS; ++i)
+        {
+#if defined(__linux__)
+            if(fds_[i] >= 0)
+            {
+                close(fds_[i]);
+            }
+#endif
+            fds_[i] = -1;
+        }
+    }
+
+    int fds_[(int)PerfEvent::NUM_EVENTS];
+    bool available_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+#endif
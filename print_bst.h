@@ -1,6 +1,6 @@
 #include <cmath>
 #include <iomanip>
-#include <map>
+#include <ostream>
 #include <vector>
 #include <cstdint>
 
@@ -8,37 +8,39 @@
 #define PRINT_BST_H
 
 // BST pretty-print function
-// Version 1.2
+// Version 1.3
 
 // maximum depth of tree to actually print.
 #define PPBST_MAX_HEIGHT 6
 
-// Returns the node's distance from the given root.
-// 1 means that it is the root.
-// Returns -1 (not found) if the distance is more than PPBST_MAX_HEIGHT,
-// or -2 if the tree is inconsistent.
+// Appends the nodes of the top maxDepth levels of the subtree at root to
+// nodes, in order. Only those nodes are visited, so the cost does not depend
+// on the size of the tree.
 template<typename Key, typename Value>
-int getNodeDepth(BinarySearchTree<Key, Value> const & tree, Node<Key, Value> * root, Node<Key, Value> * node)
+void getPrintedNodes(Node<Key, Value> * root, int maxDepth, std::vector<Node<Key, Value> *> & nodes)
 {
-    int dist = 1;
-
-    while(node != root)
+    if(root == nullptr || maxDepth <= 0)
     {
-        if(node == nullptr)
-        {
-            return -2;
-        }
+        return;
+    }
 
-        ++dist;
-        node = node->getParent();
+    getPrintedNodes(root->getLeft(), maxDepth - 1, nodes);
+    nodes.push_back(root);
+    getPrintedNodes(root->getRight(), maxDepth - 1, nodes);
+}
 
-        if(dist > PPBST_MAX_HEIGHT)
+// Returns the placeholder number of a printed node: its position in nodes, plus one.
+template<typename Key, typename Value>
+uint16_t getPlaceholder(std::vector<Node<Key, Value> *> const & nodes, Node<Key, Value> * node)
+{
+    for(size_t index = 0; index < nodes.size(); ++index)
+    {
+        if(nodes[index] == node)
         {
-            return -1;
+            return (uint16_t)(index + 1);
         }
     }
-
-    return dist;
+    return 0;
 }
 
 // Returns the height of the subtree at root.
@@ -93,12 +95,12 @@ int getSubtreeHeight(Node<Key, Value> * root, int recursionDepth = 1)
     */
 
 template<typename Key, typename Value>
-void BinarySearchTree<Key, Value>::printRoot (Node<Key, Value>* root) const
+void BinarySearchTree<Key, Value>::printRoot (Node<Key, Value>* root, std::ostream& out) const
 {
     // special case for empty trees:
     if(root == nullptr)
     {
-        std::cout << "<empty tree>" << std::endl;
+        out << "<empty tree>" << std::endl;
         return;
     }
 
@@ -106,8 +108,8 @@ void BinarySearchTree<Key, Value>::printRoot (Node<Key, Value>* root) const
 #define PADDING 2 // distance between elements at bottom row
 #define ELEMENT_WIDTH (BOX_WIDTH + PADDING)
 
-    // save initial cout state (from https://stackoverflow.com/questions/2273330/restore-the-state-of-stdcout-after-manipulating-it)
-    std::ios::fmtflags origCoutState(std::cout.flags());
+    // save initial stream state (from https://stackoverflow.com/questions/2273330/restore-the-state-of-stdcout-after-manipulating-it)
+    std::ios::fmtflags origStreamState(out.flags());
 
     // do some initial calculations
     // ----------------------------------------------------------------------
@@ -127,20 +129,10 @@ void BinarySearchTree<Key, Value>::printRoot (Node<Key, Value>* root) const
 
     // get placeholders
     // ----------------------------------------------------------------------
-    std::map<Key, uint8_t> valuePlaceholders;
-
-    uint8_t nextPlaceHolderVal = 1;
-    for(typename BinarySearchTree<Key, Value>::iterator treeIter = this->begin(); treeIter != this->end(); ++treeIter)
-    {
-
-        if(getNodeDepth(*this, root, treeIter.current_) != -1)
-        {
-            // note; the iterator will traverse in sorted order so values should get the same placeholders between
-            // different calls as long as the tree is the same
-            valuePlaceholders.insert(std::make_pair(treeIter->first, nextPlaceHolderVal++));
-        }
-
-    }
+    // the printed nodes in order, so keys get the same placeholders between
+    // different calls as long as the tree is the same
+    std::vector<Node<Key, Value> *> printedNodes;
+    getPrintedNodes(root, (int)printedTreeHeight, printedNodes);
 
     // print tree
     // ----------------------------------------------------------------------
@@ -158,25 +150,25 @@ void BinarySearchTree<Key, Value>::printRoot (Node<Key, Value>* root) const
         uint16_t numElements =(uint16_t)std::pow(2, levelIndex);
 
         // print elements themselves
-        std::cout << std::string(firstElementMargin, ' ');
+        out << std::string(firstElementMargin, ' ');
         for(size_t elementIndex = 0; elementIndex < numElements; ++elementIndex)
         {
             if(currRowNodes[elementIndex] == nullptr)
             {
-                std::cout << "    ";
+                out << "    ";
             }
             else
             {
-                uint16_t placeholder = valuePlaceholders[currRowNodes[elementIndex]->getItem().first];
-                std::cout << "[" << std::setfill('0') << std::setw(2) << placeholder << "]";
+                uint16_t placeholder = getPlaceholder(printedNodes, currRowNodes[elementIndex]);
+                out << "[" << std::setfill('0') << std::setw(2) << placeholder << "]";
             }
 
             if(elementIndex != ((uint16_t)(numElements - 1)))
             {
-                std::cout << std::string(elementPadding, ' ');
+                out << std::string(elementPadding, ' ');
             }
         }
-        std::cout << std::endl;
+        out << std::endl;
 
         // spacing values for next row (worked out on paper)
         elementPadding = ((uint16_t)((elementPadding - BOX_WIDTH) / 2));
@@ -205,7 +197,7 @@ void BinarySearchTree<Key, Value>::printRoot (Node<Key, Value>* root) const
         if(levelIndex < printedTreeHeight - 1)
         {
             // start above middle side of first element
-            std::cout << std::string(firstElementMargin + 2, ' ');
+            out << std::string(firstElementMargin + 2, ' ');
 
             for(size_t prevRowElementIndex = 0; prevRowElementIndex < prevRowNodes.size(); ++prevRowElementIndex)
             {
@@ -214,83 +206,69 @@ void BinarySearchTree<Key, Value>::printRoot (Node<Key, Value>* root) const
                 // print first branch
                 if(currNode == nullptr || currNode->getLeft() == nullptr)
                 {
-                    std::cout << std::string(elementPadding/2 + 3, ' ');
+                    out << std::string(elementPadding/2 + 3, ' ');
                 }
                 else
                 {
-                    std::cout << "\u250c";
+                    out << "\u250c";
 
                     for(int numLines = 0; numLines < (elementPadding/2 - 1); ++numLines)
                     {
-                        std::cout << u8"\u2500";
+                        out << u8"\u2500";
                     }
 
-                    std::cout << "\u2518  ";
+                    out << "\u2518  ";
                 }
 
                 // print second branch
                 if(currNode == nullptr || currNode->getRight() == nullptr)
                 {
-                    std::cout << std::string(elementPadding/2 + 3, ' ');
+                    out << std::string(elementPadding/2 + 3, ' ');
                 }
                 else
                 {
-                    std::cout << "\u2514";
+                    out << "\u2514";
 
                     for(int numLines = 0; numLines < (elementPadding/2 - 1); ++numLines)
                     {
-                        std::cout << u8"\u2500";
+                        out << u8"\u2500";
                     }
 
-                    std::cout << "\u2510  ";
+                    out << "\u2510  ";
                 }
 
-                std::cout << std::string(elementPadding + 2, ' ');
+                out << std::string(elementPadding + 2, ' ');
 
             }
 
 
-            std::cout << std::endl;
+            out << std::endl;
 
         }
     }
 
-    std::cout << std::endl;
+    out << std::endl;
     if(clippedFinalElements)
     {
-        std::cout << "(deeper levels omitted due to space limitations)" << std::endl;
+        out << "(deeper levels omitted due to space limitations)" << std::endl;
     }
 
 
     if(!std::is_same<Key, uint8_t>::value) // print placeholder explanations if needed:
     {
-        std::cout << "Tree Placeholders:------------------" << std::endl;
-        for(typename std::map<Key, uint8_t>::iterator placeholdersIter = valuePlaceholders.begin(); placeholdersIter != valuePlaceholders.end(); ++placeholdersIter)
+        out << "Tree Placeholders:------------------" << std::endl;
+        for(size_t index = 0; index < printedNodes.size(); ++index)
         {
-            std::cout << '[' << std::setfill('0') << std::setw(2) << ((uint16_t)placeholdersIter->second) << "] -> ";
-
-            // print element with original cout flags
-            std::cout.flags(origCoutState);
-            std::cout << '(' << placeholdersIter->first << ", ";
-
-            typename BinarySearchTree<Key, Value>::iterator elementIter = this->find(placeholdersIter->first);
-            if(elementIter == this->end())
-            {
-                std::cout << "<error: lookup failed>";
-            }
-            else
-            {
-                std::cout << elementIter->second;
-            }
-
-            std::cout << ')' << std::endl;
-
+            out << '[' << std::setfill('0') << std::setw(2) << (index + 1) << "] -> ";
 
+            // print element with original stream flags
+            out.flags(origStreamState);
+            out << '(' << printedNodes[index]->getKey() << ", " << printedNodes[index]->getValue() << ')' << std::endl;
         }
     }
 
-    // restore original cout flags
-    std::cout.flags(origCoutState);
+    // restore original stream flags
+    out.flags(origStreamState);
 
 }
 
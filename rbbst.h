@@ -0,0 +1,432 @@
+#ifndef RBBST_H
+#define RBBST_H
+
+#include <iostream>
+#include <exception>
+#include <cstdlib>
+#include <cstdint>
+#include <algorithm>
+#include "bst.h"
+
+/**
+* The two colours a red-black node can take.
+*/
+enum RBColour : uint8_t { RB_RED, RB_BLACK };
+
+/**
+* A special kind of node for a red-black tree, which adds a single colour bit in
+* place of the AVLNode's balance. Null children are considered black.
+*/
+template <typename Key, typename Value>
+class RBNode : public Node<Key, Value>
+{
+public:
+    // Constructor/destructor.
+    RBNode(const Key& key, const Value& value, RBNode<Key, Value>* parent, typename Node<Key, Value>::ItemStore* store = nullptr);
+    virtual ~RBNode();
+
+    // Getter/setter for the node's colour.
+    RBColour getColour() const;
+    void setColour(RBColour colour);
+    bool isRed() const;
+
+    // Getters for parent, left, and right. These need to be redefined since they
+    // return pointers to RBNodes - not plain Nodes. See the Node class in bst.h
+    // for more information.
+    virtual RBNode<Key, Value>* getParent() const override;
+    virtual RBNode<Key, Value>* getLeft() const override;
+    virtual RBNode<Key, Value>* getRight() const override;
+
+protected:
+    RBColour colour_;
+};
+
+/*
+  -------------------------------------------------
+  Begin implementations for the RBNode class.
+  -------------------------------------------------
+*/
+
+/**
+* An explicit constructor to initialize the elements by calling the base class constructor.
+* New nodes are always red.
+*/
+template<class Key, class Value>
+RBNode<Key, Value>::RBNode(const Key& key, const Value& value, RBNode<Key, Value> *parent, typename Node<Key, Value>::ItemStore* store) :
+    Node<Key, Value>(key, value, parent, store), colour_(RB_RED)
+{
+
+}
+
+/**
+* A destructor which does nothing.
+*/
+template<class Key, class Value>
+RBNode<Key, Value>::~RBNode()
+{
+
+}
+
+/**
+* A getter for the colour of a RBNode.
+*/
+template<class Key, class Value>
+RBColour RBNode<Key, Value>::getColour() const
+{
+    return colour_;
+}
+
+/**
+* A setter for the colour of a RBNode.
+*/
+template<class Key, class Value>
+void RBNode<Key, Value>::setColour(RBColour colour)
+{
+    colour_ = colour;
+}
+
+/**
+* Returns true iff the node is red.
+*/
+template<class Key, class Value>
+bool RBNode<Key, Value>::isRed() const
+{
+    return colour_ == RB_RED;
+}
+
+/**
+* An overridden function for getting the parent since a static_cast is necessary to make sure
+* that our node is a RBNode.
+*/
+template<class Key, class Value>
+RBNode<Key, Value> *RBNode<Key, Value>::getParent() const
+{
+    return static_cast<RBNode<Key, Value>*>(this->parent_);
+}
+
+/**
+* Overridden for the same reasons as above.
+*/
+template<class Key, class Value>
+RBNode<Key, Value> *RBNode<Key, Value>::getLeft() const
+{
+    return static_cast<RBNode<Key, Value>*>(this->getChild(0));
+}
+
+/**
+* Overridden for the same reasons as above.
+*/
+template<class Key, class Value>
+RBNode<Key, Value> *RBNode<Key, Value>::getRight() const
+{
+    return static_cast<RBNode<Key, Value>*>(this->getChild(1));
+}
+
+
+/*
+  -----------------------------------------------
+  End implementations for the RBNode class.
+  -----------------------------------------------
+*/
+
+
+/**
+* A red-black tree. Lookups and iteration are inherited from BinarySearchTree;
+* insert and remove restore the red-black properties with recolouring and at
+* most two (insert) or three (remove) rotations.
+*/
+template <class Key, class Value>
+class RedBlackTree : public BinarySearchTree<Key, Value>
+{
+protected:
+    virtual void nodeSwap( RBNode<Key,Value>* n1, RBNode<Key,Value>* n2);
+    virtual Node<Key, Value>* insertAt(Node<Key, Value>* parent, bool isLeft, const std::pair<const Key, Value>& new_item);
+
+    void rotateLeft(RBNode<Key, Value>* top);
+    void rotateRight(RBNode<Key, Value>* top);
+    void insertFix(RBNode<Key, Value>* node);
+    void removeFix(RBNode<Key, Value>* node);
+    virtual void linkNode(Node<Key, Value>* parent, bool isLeft, Node<Key, Value>* node);
+    virtual void unlinkNode(Node<Key, Value>* node);
+    virtual void rebuiltNode(Node<Key, Value>* node, int leftHeight, int rightHeight);
+    virtual void rebuiltTree(size_t removed, int height);
+    static bool isBlack(RBNode<Key, Value>* node);
+};
+
+/**
+* Null children count as black.
+*/
+template<class Key, class Value>
+bool RedBlackTree<Key, Value>::isBlack(RBNode<Key, Value>* node)
+{
+    return (node == nullptr) || !(node -> isRed());
+}
+
+/**
+* Links a new red node into the given empty slot and fixes up the colours.
+*/
+template<class Key, class Value>
+Node<Key, Value>* RedBlackTree<Key, Value>::insertAt(Node<Key, Value>* parent, bool isLeft, const std::pair<const Key, Value>& new_item)
+{
+    RBNode<Key, Value>* new_node = new RBNode<Key, Value>(new_item.first, new_item.second, static_cast<RBNode<Key, Value>*>(parent), this -> itemStore());
+    BST_COUNT(allocations, 1);
+    linkNode(parent, isLeft, new_node);
+    return new_node;
+}
+
+/**
+* Links a leaf into the given empty slot as a red node and fixes up the
+* colours. The node may come from another tree with any colour.
+*/
+template<class Key, class Value>
+void RedBlackTree<Key, Value>::linkNode(Node<Key, Value>* parent, bool isLeft, Node<Key, Value>* node)
+{
+    RBNode<Key, Value>* new_node = static_cast<RBNode<Key, Value>*>(node);
+    new_node -> setColour(RB_RED);
+    this -> attachNode(parent, isLeft, new_node);
+    insertFix(new_node);
+}
+
+/**
+* Restores the red-black properties after node (which is red) was linked in
+* below a possibly red parent.
+*/
+template<class Key, class Value>
+void RedBlackTree<Key, Value>::insertFix(RBNode<Key, Value>* node)
+{
+    while (node -> getParent() != nullptr && node -> getParent() -> isRed()){
+        RBNode<Key, Value>* parent = node -> getParent();
+        //a red parent is never the root, so the grandparent exists
+        RBNode<Key, Value>* grand = parent -> getParent();
+
+        if (parent == grand -> getLeft()){
+            RBNode<Key, Value>* uncle = grand -> getRight();
+            if (!isBlack(uncle)){ //red uncle: push the blackness down from grand
+                parent -> setColour(RB_BLACK);
+                uncle -> setColour(RB_BLACK);
+                grand -> setColour(RB_RED);
+                node = grand;
+                continue;
+            }
+            BST_COUNT(restructures, 1);
+            if (node == parent -> getRight()){ //zig-zag: straighten it first
+                rotateLeft(parent);
+                node = parent;
+                parent = node -> getParent();
+            }
+            parent -> setColour(RB_BLACK);
+            grand -> setColour(RB_RED);
+            rotateRight(grand);
+        } else {
+            RBNode<Key, Value>* uncle = grand -> getLeft();
+            if (!isBlack(uncle)){
+                parent -> setColour(RB_BLACK);
+                uncle -> setColour(RB_BLACK);
+                grand -> setColour(RB_RED);
+                node = grand;
+                continue;
+            }
+            BST_COUNT(restructures, 1);
+            if (node == parent -> getLeft()){
+                rotateRight(parent);
+                node = parent;
+                parent = node -> getParent();
+            }
+            parent -> setColour(RB_BLACK);
+            grand -> setColour(RB_RED);
+            rotateLeft(grand);
+        }
+    }
+    static_cast<RBNode<Key, Value>*>(this -> root_) -> setColour(RB_BLACK);
+}
+
+template <class Key, class Value>
+void RedBlackTree<Key, Value>::rotateRight(RBNode<Key, Value>* top){
+    BST_COUNT(rotations, 1);
+    RBNode<Key, Value>* child = top -> getLeft();
+    RBNode<Key, Value>* parent = top -> getParent();
+
+    top -> setLeft(child -> getRight());
+    if (child -> getRight() != nullptr){
+        child -> getRight() -> setParent(top);
+    }
+    child -> setParent(parent);
+    if (parent == nullptr){
+        this -> root_ = child;
+    } else if (top == parent -> getLeft()){
+        parent -> setLeft(child);
+    } else {
+        parent -> setRight(child);
+    }
+    child -> setRight(top);
+    top -> setParent(child);
+}
+
+template <class Key, class Value>
+void RedBlackTree<Key, Value>::rotateLeft(RBNode<Key, Value>* top){
+    BST_COUNT(rotations, 1);
+    RBNode<Key, Value>* child = top -> getRight();
+    RBNode<Key, Value>* parent = top -> getParent();
+
+    top -> setRight(child -> getLeft());
+    if (child -> getLeft() != nullptr){
+        child -> getLeft() -> setParent(top);
+    }
+    child -> setParent(parent);
+    if (parent == nullptr){
+        this -> root_ = child;
+    } else if (top == parent -> getLeft()){
+        parent -> setLeft(child);
+    } else {
+        parent -> setRight(child);
+    }
+    child -> setLeft(top);
+    top -> setParent(child);
+}
+
+/**
+* Unlinks node, recolouring and rotating to keep the red-black
+* properties.
+*/
+template<class Key, class Value>
+void RedBlackTree<Key, Value>::unlinkNode(Node<Key, Value>* node)
+{
+    RBNode<Key, Value>* cn = static_cast<RBNode<Key, Value>*>(node);
+    this -> retreatRightmost(cn);
+
+    //if cn has two children, swap it with its predecessor so it has at most one
+    if ((cn -> getRight() != nullptr) && (cn -> getLeft() != nullptr)){
+        RBNode<Key, Value>* swap = static_cast<RBNode<Key, Value>*>(this -> predecessor(cn));
+        nodeSwap(cn, swap);
+    }
+
+    RBNode<Key, Value>* child = cn -> getLeft();
+    if (child == nullptr){
+        child = cn -> getRight();
+    }
+
+    //removing a black leaf shortens every path through it, so fix the tree
+    //while cn is still in place. A black node with one child always has a red
+    //child, which simply takes over its blackness below.
+    if (child == nullptr && !(cn -> isRed())){
+        removeFix(cn);
+    } else if (child != nullptr){
+        child -> setColour(RB_BLACK);
+    }
+
+    RBNode<Key, Value>* parent = cn -> getParent();
+    if (child != nullptr){
+        child -> setParent(parent);
+    }
+    if (parent == nullptr){
+        this -> root_ = child;
+    } else if (cn == parent -> getLeft()){
+        parent -> setLeft(child);
+    } else {
+        parent -> setRight(child);
+    }
+}
+
+/**
+* Resolves the "double black" at node, which is black and about to lose one
+* unit of black height. Every case either terminates or moves the problem up
+* one level without rotating, so at most three rotations are performed.
+*/
+template<class Key, class Value>
+void RedBlackTree<Key, Value>::removeFix(RBNode<Key, Value>* node)
+{
+    BST_COUNT(removeFixes, 1);
+    while (node != this -> root_ && isBlack(node)){
+        RBNode<Key, Value>* parent = node -> getParent();
+
+        if (node == parent -> getLeft()){
+            RBNode<Key, Value>* sibling = parent -> getRight();
+            if (sibling -> isRed()){ //make the sibling black
+                sibling -> setColour(RB_BLACK);
+                parent -> setColour(RB_RED);
+                rotateLeft(parent);
+                sibling = parent -> getRight();
+            }
+            if (isBlack(sibling -> getLeft()) && isBlack(sibling -> getRight())){
+                sibling -> setColour(RB_RED);
+                node = parent;
+                continue;
+            }
+            if (isBlack(sibling -> getRight())){ //near nephew is red: rotate it outside
+                sibling -> getLeft() -> setColour(RB_BLACK);
+                sibling -> setColour(RB_RED);
+                rotateRight(sibling);
+                sibling = parent -> getRight();
+            }
+            sibling -> setColour(parent -> getColour());
+            parent -> setColour(RB_BLACK);
+            sibling -> getRight() -> setColour(RB_BLACK);
+            rotateLeft(parent);
+        } else {
+            RBNode<Key, Value>* sibling = parent -> getLeft();
+            if (sibling -> isRed()){
+                sibling -> setColour(RB_BLACK);
+                parent -> setColour(RB_RED);
+                rotateRight(parent);
+                sibling = parent -> getLeft();
+            }
+            if (isBlack(sibling -> getLeft()) && isBlack(sibling -> getRight())){
+                sibling -> setColour(RB_RED);
+                node = parent;
+                continue;
+            }
+            if (isBlack(sibling -> getLeft())){
+                sibling -> getRight() -> setColour(RB_BLACK);
+                sibling -> setColour(RB_RED);
+                rotateLeft(sibling);
+                sibling = parent -> getLeft();
+            }
+            sibling -> setColour(parent -> getColour());
+            parent -> setColour(RB_BLACK);
+            sibling -> getLeft() -> setColour(RB_BLACK);
+            rotateRight(parent);
+        }
+        return;
+    }
+    node -> setColour(RB_BLACK);
+}
+
+/**
+* linkBalanced builds trees whose sibling heights differ by at most one, and
+* such a tree is a valid red-black tree when a node is red exactly if its
+* height is odd and one less than its parent's. Below a node of height h,
+* every path then meets (h - 1) / 2 black nodes. Each node colours its
+* children here; the root is made black in rebuiltTree.
+*/
+template<class Key, class Value>
+void RedBlackTree<Key, Value>::rebuiltNode(Node<Key, Value>* node, int leftHeight, int rightHeight)
+{
+    RBNode<Key, Value>* cn = static_cast<RBNode<Key, Value>*>(node);
+    int height = 1 + std::max(leftHeight, rightHeight);
+    if (cn -> getLeft() != nullptr){
+        cn -> getLeft() -> setColour(((leftHeight & 1) && leftHeight == height - 1) ? RB_RED : RB_BLACK);
+    }
+    if (cn -> getRight() != nullptr){
+        cn -> getRight() -> setColour(((rightHeight & 1) && rightHeight == height - 1) ? RB_RED : RB_BLACK);
+    }
+}
+
+template<class Key, class Value>
+void RedBlackTree<Key, Value>::rebuiltTree(size_t removed, int height)
+{
+    if (this -> root_ != nullptr){
+        static_cast<RBNode<Key, Value>*>(this -> root_) -> setColour(RB_BLACK);
+    }
+}
+
+template<class Key, class Value>
+void RedBlackTree<Key, Value>::nodeSwap( RBNode<Key,Value>* n1, RBNode<Key,Value>* n2)
+{
+    BinarySearchTree<Key, Value>::nodeSwap(n1, n2);
+    RBColour tempC = n1->getColour();
+    n1->setColour(n2->getColour());
+    n2->setColour(tempC);
+}
+
+
+#endif
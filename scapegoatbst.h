@@ -0,0 +1,189 @@
+#ifndef SCAPEGOATBST_H
+#define SCAPEGOATBST_H
+
+#include <iostream>
+#include <exception>
+#include <cstdlib>
+#include <cmath>
+#include "bst.h"
+
+/**
+* A scapegoat tree. Nodes are the plain Node from bst.h and carry no balance
+* information at all; the tree only keeps its size. When an insert lands deeper
+* than log_{1/alpha}(size), the highest alpha-unbalanced ancestor on the insert
+* path (the scapegoat) is rebuilt in linear time with rebuildSubtree. When
+* removals shrink the tree below alpha times its peak size, the whole tree is
+* rebuilt. Lookups are inherited unchanged and never touch the tree.
+*
+* alpha is in (0.5, 1): lower values keep the tree shallower at the cost of
+* more frequent rebuilds.
+*/
+template <class Key, class Value>
+class ScapegoatTree : public BinarySearchTree<Key, Value>
+{
+public:
+    ScapegoatTree(double alpha = 0.7);
+    size_t size() const;
+
+protected:
+    virtual Node<Key, Value>* insertAt(Node<Key, Value>* parent, bool isLeft, const std::pair<const Key, Value>& new_item);
+    void insertFix(Node<Key, Value>* new_node, int depth);
+    int maxDepth() const;
+    static size_t subtreeSize(Node<Key, Value>* node);
+    virtual void linkNode(Node<Key, Value>* parent, bool isLeft, Node<Key, Value>* node);
+    virtual void unlinkNode(Node<Key, Value>* node);
+    virtual void rebuiltTree(size_t removed, int height);
+    virtual void cleared();
+
+    double alpha_;
+    size_t size_;
+    size_t maxSize_;
+};
+
+template<class Key, class Value>
+ScapegoatTree<Key, Value>::ScapegoatTree(double alpha) :
+    alpha_(alpha), size_(0), maxSize_(0)
+{
+
+}
+
+/**
+* Returns the number of keys in the tree.
+*/
+template<class Key, class Value>
+size_t ScapegoatTree<Key, Value>::size() const
+{
+    return size_;
+}
+
+/**
+* Returns the deepest a node may sit (root = 0) before a rebuild is triggered.
+*/
+template<class Key, class Value>
+int ScapegoatTree<Key, Value>::maxDepth() const
+{
+    return (int)std::floor(std::log((double)size_) / std::log(1.0 / alpha_));
+}
+
+/**
+* Counts the nodes in a subtree without recursion.
+*/
+template<class Key, class Value>
+size_t ScapegoatTree<Key, Value>::subtreeSize(Node<Key, Value>* node)
+{
+    size_t count = 0;
+    std::vector<Node<Key, Value>*> pending;
+    if (node != nullptr){
+        pending.push_back(node);
+    }
+    while (!pending.empty()){
+        Node<Key, Value>* cn = pending.back();
+        pending.pop_back();
+        ++count;
+        if (cn -> getLeft() != nullptr){
+            pending.push_back(cn -> getLeft());
+        }
+        if (cn -> getRight() != nullptr){
+            pending.push_back(cn -> getRight());
+        }
+    }
+    return count;
+}
+
+/**
+* Links a new node into the given empty slot.
+*/
+template<class Key, class Value>
+Node<Key, Value>* ScapegoatTree<Key, Value>::insertAt(Node<Key, Value>* parent, bool isLeft, const std::pair<const Key, Value>& new_item)
+{
+    Node<Key, Value>* new_node = new Node<Key, Value>(new_item.first, new_item.second, parent, this -> itemStore());
+    BST_COUNT(allocations, 1);
+    linkNode(parent, isLeft, new_node);
+    return new_node;
+}
+
+/**
+* Links a leaf into the given empty slot. The depth is not known from a
+* descent here, so it is measured by climbing to the root.
+*/
+template<class Key, class Value>
+void ScapegoatTree<Key, Value>::linkNode(Node<Key, Value>* parent, bool isLeft, Node<Key, Value>* node)
+{
+    this -> attachNode(parent, isLeft, node);
+    int depth = 0;
+    for (Node<Key, Value>* cn = parent; cn != nullptr; cn = cn -> getParent()){
+        ++depth;
+    }
+    insertFix(node, depth);
+}
+
+/**
+* Updates the size counters after new_node was linked at the given depth and
+* rebuilds around the scapegoat if the node is too deep.
+*/
+template<class Key, class Value>
+void ScapegoatTree<Key, Value>::insertFix(Node<Key, Value>* new_node, int depth)
+{
+    ++size_;
+    maxSize_ = std::max(maxSize_, size_);
+
+    if (depth <= maxDepth()){
+        return;
+    }
+
+    //too deep: walk up until a child holds more than alpha of its parent's subtree.
+    //Such an ancestor always exists on a path this long.
+    Node<Key, Value>* child = new_node;
+    size_t childSize = 1;
+    Node<Key, Value>* parent = new_node -> getParent();
+    while (parent != nullptr){
+        Node<Key, Value>* sibling = (parent -> getLeft() == child) ? parent -> getRight() : parent -> getLeft();
+        size_t parentSize = childSize + 1 + subtreeSize(sibling);
+        if ((double)childSize > alpha_ * (double)parentSize){
+            this -> rebuildSubtree(parent);
+            return;
+        }
+        child = parent;
+        childSize = parentSize;
+        parent = parent -> getParent();
+    }
+}
+
+/**
+* Unlinks node and rebuilds the whole tree once it has shrunk below alpha
+* times its peak size.
+*/
+template<class Key, class Value>
+void ScapegoatTree<Key, Value>::unlinkNode(Node<Key, Value>* node)
+{
+    this -> removeNode(node);
+    --size_;
+
+    if ((double)size_ < alpha_ * (double)maxSize_){
+        this -> rebuildSubtree(this -> root_);
+        maxSize_ = size_;
+    }
+}
+
+/**
+* A range erase leaves a perfectly balanced tree, which is the new peak.
+*/
+template<class Key, class Value>
+void ScapegoatTree<Key, Value>::rebuiltTree(size_t removed, int height)
+{
+    size_ -= removed;
+    maxSize_ = size_;
+}
+
+/**
+* clear() deleted every node, so the size counters start over.
+*/
+template<class Key, class Value>
+void ScapegoatTree<Key, Value>::cleared()
+{
+    size_ = 0;
+    maxSize_ = 0;
+}
+
+
+#endif
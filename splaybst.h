@@ -0,0 +1,212 @@
+#ifndef SPLAYBST_H
+#define SPLAYBST_H
+
+#include <iostream>
+#include <exception>
+#include <cstdlib>
+#include <stdexcept>
+#include "bst.h"
+
+/**
+* A self-adjusting splay tree. Every find, insert and remove splays the node it
+* touches (or the last node visited, on a miss) to the root, so frequently used
+* keys stay near the top. Uses the plain Node from bst.h; no per-node metadata.
+*
+* Since lookups restructure the tree, find and operator[] are non-const here
+* and hide the BinarySearchTree versions.
+*/
+template <class Key, class Value>
+class SplayTree : public BinarySearchTree<Key, Value>
+{
+public:
+    using BinarySearchTree<Key, Value>::insert;
+    virtual void insert (const std::pair<const Key, Value> &new_item);
+    virtual void remove(const Key& key);
+    typename BinarySearchTree<Key, Value>::iterator find(const Key& key);
+    Value& operator[](const Key& key);
+
+protected:
+    virtual Node<Key, Value>* insertAt(Node<Key, Value>* parent, bool isLeft, const std::pair<const Key, Value>& new_item);
+    void rotateUp(Node<Key, Value>* node);
+    void splay(Node<Key, Value>* node, Node<Key, Value>* stop);
+    Node<Key, Value>* splayFind(const Key& key);
+    virtual void linkNode(Node<Key, Value>* parent, bool isLeft, Node<Key, Value>* node);
+    virtual void unlinkNode(Node<Key, Value>* node);
+};
+
+/**
+* Rotates node above its parent, keeping the in-order sequence.
+*/
+template<class Key, class Value>
+void SplayTree<Key, Value>::rotateUp(Node<Key, Value>* node)
+{
+    BST_COUNT(rotations, 1);
+    Node<Key, Value>* parent = node -> getParent();
+    Node<Key, Value>* grand = parent -> getParent();
+
+    if (node == parent -> getLeft()){
+        parent -> setLeft(node -> getRight());
+        if (node -> getRight() != nullptr){
+            node -> getRight() -> setParent(parent);
+        }
+        node -> setRight(parent);
+    } else {
+        parent -> setRight(node -> getLeft());
+        if (node -> getLeft() != nullptr){
+            node -> getLeft() -> setParent(parent);
+        }
+        node -> setLeft(parent);
+    }
+    parent -> setParent(node);
+    node -> setParent(grand);
+
+    if (grand == nullptr){
+        this -> root_ = node;
+    } else if (grand -> getLeft() == parent){
+        grand -> setLeft(node);
+    } else {
+        grand -> setRight(node);
+    }
+}
+
+/**
+* Splays node upwards until its parent is stop (nullptr splays it to the root).
+*/
+template<class Key, class Value>
+void SplayTree<Key, Value>::splay(Node<Key, Value>* node, Node<Key, Value>* stop)
+{
+    while (node -> getParent() != stop){
+        Node<Key, Value>* parent = node -> getParent();
+        Node<Key, Value>* grand = parent -> getParent();
+        if (grand == stop){ //zig
+            rotateUp(node);
+        } else if ((node == parent -> getLeft()) == (parent == grand -> getLeft())){ //zig-zig
+            rotateUp(parent);
+            rotateUp(node);
+        } else { //zig-zag
+            rotateUp(node);
+            rotateUp(node);
+        }
+    }
+}
+
+/**
+* Searches for key and splays the node holding it to the root. On a miss the
+* last node on the search path is splayed instead and nullptr is returned.
+*/
+template<class Key, class Value>
+Node<Key, Value>* SplayTree<Key, Value>::splayFind(const Key& key)
+{
+    //on a miss the slot's parent is the last node on the search path
+    Node<Key, Value>* last;
+    bool isLeft;
+    Node<Key, Value>* cn = this -> descend(key, last, isLeft);
+    if (cn != nullptr){
+        last = cn;
+    }
+    if (last != nullptr){
+        splay(last, nullptr);
+    }
+    return cn;
+}
+
+template<class Key, class Value>
+typename BinarySearchTree<Key, Value>::iterator SplayTree<Key, Value>::find(const Key& key)
+{
+    //a miss returns nullptr, which is end()
+    return this -> iteratorAt(splayFind(key));
+}
+
+/**
+ * @precondition The key exists in the map
+ * Returns the value associated with the key
+ */
+template<class Key, class Value>
+Value& SplayTree<Key, Value>::operator[](const Key& key)
+{
+    Node<Key, Value>* curr = splayFind(key);
+    if(curr == NULL) throw std::out_of_range("Invalid key");
+    return curr->getValue();
+}
+
+/*
+ * Recall: If key is already in the tree, you should
+ * overwrite the current value with the updated value.
+ */
+template<class Key, class Value>
+void SplayTree<Key, Value>::insert (const std::pair<const Key, Value> &new_item)
+{
+    Node<Key, Value>* pn; //parent_node
+    bool isLeft;
+    Node<Key, Value>* cn = this -> findSlot(new_item.first, pn, isLeft);
+    if (cn != nullptr){
+        cn -> setValue(new_item.second);
+        splay(cn, nullptr);
+        return;
+    }
+    insertAt(pn, isLeft, new_item);
+}
+
+/**
+* Links a new node into the given empty slot and splays it to the root.
+*/
+template<class Key, class Value>
+Node<Key, Value>* SplayTree<Key, Value>::insertAt(Node<Key, Value>* parent, bool isLeft, const std::pair<const Key, Value>& new_item)
+{
+    Node<Key, Value>* new_node = new Node<Key, Value>(new_item.first, new_item.second, parent, this -> itemStore());
+    BST_COUNT(allocations, 1);
+    linkNode(parent, isLeft, new_node);
+    return new_node;
+}
+
+/**
+* Links a leaf into the given empty slot and splays it to the root.
+*/
+template<class Key, class Value>
+void SplayTree<Key, Value>::linkNode(Node<Key, Value>* parent, bool isLeft, Node<Key, Value>* node)
+{
+    this -> attachNode(parent, isLeft, node);
+    splay(node, nullptr);
+}
+
+template<class Key, class Value>
+void SplayTree<Key, Value>::remove(const Key& key)
+{
+    Node<Key, Value>* cn = splayFind(key);
+    if (cn == nullptr){ //key not found in tree
+        return;
+    }
+    this -> eraseNode(cn);
+}
+
+/**
+* Splays the node to the root, then joins its two subtrees by splaying the
+* predecessor up to become the new root (it has no right child at that point).
+*/
+template<class Key, class Value>
+void SplayTree<Key, Value>::unlinkNode(Node<Key, Value>* cn)
+{
+    splay(cn, nullptr);
+    this -> retreatRightmost(cn);
+
+    Node<Key, Value>* left = cn -> getLeft();
+    Node<Key, Value>* right = cn -> getRight();
+    if (left == nullptr){
+        this -> root_ = right;
+        if (right != nullptr){
+            right -> setParent(nullptr);
+        }
+    } else {
+        Node<Key, Value>* pred = this -> predecessor(cn);
+        splay(pred, cn);
+        pred -> setRight(right);
+        if (right != nullptr){
+            right -> setParent(pred);
+        }
+        pred -> setParent(nullptr);
+        this -> root_ = pred;
+    }
+}
+
+
+#endif
@@ -0,0 +1,314 @@
+#ifndef TREE_EXPORT_H
+#define TREE_EXPORT_H
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include "bst.h"
+#include "avlbst.h"
+
+// Structure dumps of whole trees, for looking at shape problems (long
+// spines, uneven AVL balance) that the six levels of print() cannot show.
+// The nodes are written in preorder while the tree is walked through its
+// parent pointers, so memory use does not grow with the tree, and output
+// starts at once. Every node carries its depth (the root is 0); nodes of an
+// AVLTree also carry their balance (height of right minus height of left).
+
+enum class ExportFormat
+{
+    DOT,  // Graphviz digraph, one line per node and per edge
+    JSON  // an array of nested {"key", "value", "depth", ["balance"], "left", "right"} objects
+};
+
+// What to write. Only nodes with minDepth <= depth <= maxDepth are written;
+// nodes below maxDepth are not visited at all. A written node at maxDepth
+// that has children is marked (dashed in DOT, "more": true in JSON). With
+// minDepth > 0 the output holds one tree per node at minDepth.
+struct ExportOptions
+{
+    ExportOptions(ExportFormat fmt = ExportFormat::DOT) :
+        format(fmt), minDepth(0), maxDepth(INT_MAX)
+    {
+    }
+
+    ExportFormat format;
+    int minDepth;
+    int maxDepth;
+};
+
+// Writes the nodes of one subtree; used through exportTree and exportSubtree.
+// DOT node ids are the node addresses, so no table of written nodes is needed.
+template<typename Key, typename Value>
+class TreeExporter
+{
+public:
+    TreeExporter(std::ostream& out, ExportOptions const & options) :
+        out_(out), options_(options), topDepth_(0), avl_(false), first_(true)
+    {
+    }
+
+    static Node<Key, Value>* root(BinarySearchTree<Key, Value> const & tree)
+    {
+        return tree.root_;
+    }
+
+    static Node<Key, Value>* node(BinarySearchTree<Key, Value> const & tree, const Key& key)
+    {
+        return tree.internalFind(key);
+    }
+
+    // Writes the subtree at top (which may be NULL), whose root is at the given depth
+    void write(Node<Key, Value>* top, int depth)
+    {
+        // every node of a tree has the same type, so one check is enough
+        avl_ = (top != NULL) && (dynamic_cast<AVLNode<Key, Value>*>(top) != NULL);
+        topDepth_ = std::max(depth, options_.minDepth);
+        begin();
+        if(top != NULL && depth <= options_.maxDepth)
+        {
+            walk(top, depth);
+        }
+        end();
+    }
+
+private:
+    // Preorder walk without a stack: the way back up is the parent pointer,
+    // and where we came from tells which child is next
+    void walk(Node<Key, Value>* top, int depth)
+    {
+        Node<Key, Value>* node = top;
+        Node<Key, Value>* from = top->getParent();
+        while(true)
+        {
+            bool expand = depth < options_.maxDepth;
+            Node<Key, Value>* next = NULL;
+            if(from == node->getParent())
+            {
+                enter(node, depth);
+                next = expand ? node->getLeft() : NULL;
+                if(next == NULL && expand)
+                {
+                    next = node->getRight();
+                }
+            }
+            else if(from == node->getLeft() && expand)
+            {
+                next = node->getRight();
+            }
+
+            if(next != NULL)
+            {
+                from = node;
+                node = next;
+                ++depth;
+                continue;
+            }
+            leave(node, depth);
+            if(node == top)
+            {
+                return;
+            }
+            from = node;
+            node = node->getParent();
+            --depth;
+        }
+    }
+
+    void begin()
+    {
+        if(options_.format == ExportFormat::DOT)
+        {
+            out_ << "digraph tree {\n  node [shape=box];\n";
+        }
+        else
+        {
+            out_ << "[";
+        }
+    }
+
+    void end()
+    {
+        out_ << (options_.format == ExportFormat::DOT ? "}\n" : "]\n");
+    }
+
+    void enter(Node<Key, Value>* node, int depth)
+    {
+        if(depth < options_.minDepth)
+        {
+            return;
+        }
+        if(options_.format == ExportFormat::DOT)
+        {
+            out_ << "  n" << (const void*)node << " [label=\"" << quoted(node->getKey()) << "\\nd=" << depth;
+            if(avl_)
+            {
+                out_ << " b=" << balance(node);
+            }
+            out_ << "\"" << (truncated(node, depth) ? " style=dashed" : "") << "];\n";
+            if(depth > topDepth_)
+            {
+                Node<Key, Value>* parent = node->getParent();
+                out_ << "  n" << (const void*)parent << (parent->getLeft() == node ? ":sw" : ":se")
+                     << " -> n" << (const void*)node << ";\n";
+            }
+            return;
+        }
+
+        if(depth == topDepth_)
+        {
+            out_ << (first_ ? "" : ",") << "\n";
+            first_ = false;
+        }
+        else
+        {
+            out_ << (node->getParent()->getLeft() == node ? ",\"left\":" : ",\"right\":");
+        }
+        out_ << "{\"key\":";
+        writeJson(node->getKey());
+        out_ << ",\"value\":";
+        writeJson(node->getValue());
+        out_ << ",\"depth\":" << depth;
+        if(avl_)
+        {
+            out_ << ",\"balance\":" << balance(node);
+        }
+    }
+
+    void leave(Node<Key, Value>* node, int depth)
+    {
+        if(depth < options_.minDepth || options_.format == ExportFormat::DOT)
+        {
+            return;
+        }
+        out_ << (truncated(node, depth) ? ",\"more\":true}" : "}");
+    }
+
+    bool truncated(Node<Key, Value>* node, int depth) const
+    {
+        return depth >= options_.maxDepth && (node->getLeft() != NULL || node->getRight() != NULL);
+    }
+
+    static int balance(Node<Key, Value>* node)
+    {
+        return static_cast<AVLNode<Key, Value>*>(node)->getBalance();
+    }
+
+    // Character-sized integers are numbers here, not raw bytes
+    template<typename T>
+    static T const & printable(T const & item)
+    {
+        return item;
+    }
+
+    static int printable(signed char item)
+    {
+        return item;
+    }
+
+    static int printable(unsigned char item)
+    {
+        return item;
+    }
+
+    // JSON has no nan or inf
+    template<typename T>
+    static bool finite(T const &)
+    {
+        return true;
+    }
+
+    static bool finite(float item)
+    {
+        return std::isfinite(item);
+    }
+
+    static bool finite(double item)
+    {
+        return std::isfinite(item);
+    }
+
+    static bool finite(long double item)
+    {
+        return std::isfinite(item);
+    }
+
+    // The text of item with '"' and '\' escaped, for DOT labels and JSON strings
+    template<typename T>
+    static std::string quoted(T const & item)
+    {
+        std::ostringstream text;
+        text << printable(item);
+        std::string raw = text.str();
+        std::string escaped;
+        for(size_t i = 0; i < raw.size(); ++i)
+        {
+            if(raw[i] == '"' || raw[i] == '\\')
+            {
+                escaped += '\\';
+                escaped += raw[i];
+            }
+            else if(raw[i] == '\n')
+            {
+                escaped += "\\n";
+            }
+            else
+            {
+                escaped += raw[i];
+            }
+        }
+        return escaped;
+    }
+
+    // Numbers are written as numbers, everything else (nan and inf too) as a string
+    template<typename T>
+    void writeJson(T const & item)
+    {
+        if(std::is_arithmetic<T>::value && !std::is_same<T, bool>::value && !std::is_same<T, char>::value && finite(item))
+        {
+            out_ << printable(item);
+        }
+        else
+        {
+            out_ << "\"" << quoted(item) << "\"";
+        }
+    }
+
+    std::ostream& out_;
+    ExportOptions options_;
+    int topDepth_; // depth of the nodes written without their parent
+    bool avl_;   // the nodes are AVLNodes
+    bool first_; // no JSON tree written yet
+};
+
+/**
+* Writes the whole tree to out in the format and depth range of options.
+*/
+template<typename Key, typename Value>
+void exportTree(BinarySearchTree<Key, Value> const & tree, std::ostream& out, ExportOptions const & options)
+{
+    TreeExporter<Key, Value>(out, options).write(TreeExporter<Key, Value>::root(tree), 0);
+}
+
+/**
+* Writes only the subtree rooted at key. Depths stay those of the whole tree,
+* so the depth range applies as it would in exportTree.
+* Returns false, writing an empty graph or array, if key is not in the tree.
+*/
+template<typename Key, typename Value>
+bool exportSubtree(BinarySearchTree<Key, Value> const & tree, const Key& key, std::ostream& out, ExportOptions const & options)
+{
+    Node<Key, Value>* top = TreeExporter<Key, Value>::node(tree, key);
+    int depth = 0;
+    for(Node<Key, Value>* n = top; n != NULL && n->getParent() != NULL; n = n->getParent())
+    {
+        ++depth;
+    }
+    TreeExporter<Key, Value>(out, options).write(top, depth);
+    return top != NULL;
+}
+
+#endif